@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory/defs.h>
+#include <stdint.h>
+
+#define ARENA_BLOCK_SIZE (16 * KILOBYTE)
+
+struct ArenaMark {
+    void* block;
+    uint64_t top;
+};
+
+// Bump allocator for short lived buffers, everything allocated inside an ArenaScope is released when it ends
+// The first block is kept between scopes so the common case never touches the heap
+// Only usable from process context, not from interrupt handlers
+class Arena {
+public:
+    constexpr Arena() : first(nullptr), current(nullptr), top(0) {}
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(uint64_t size, uint64_t alignment = 16);
+
+    ArenaMark GetMark();
+    void Reset(ArenaMark mark);
+
+private:
+    struct Block {
+        Block* prev;
+        uint64_t size;
+    };
+
+    Block* first;
+    Block* current;
+    uint64_t top;
+};
+
+class ArenaScope {
+public:
+    ArenaScope(Arena* arena) : arena(arena), mark(arena->GetMark()) {}
+    ~ArenaScope() { arena->Reset(mark); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    template <class T> inline T* Allocate(uint64_t count) { return (T*)arena->Allocate(count * sizeof(T), alignof(T) < 16 ? 16 : alignof(T)); }
+
+private:
+    Arena* arena;
+    ArenaMark mark;
+};
\ No newline at end of file
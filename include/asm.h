@@ -2,4 +2,5 @@
 
 #include <stdint.h>
 
-extern "C" bool CompareExchange(void* val, uint64_t compare, uint64_t newValue);
\ No newline at end of file
+extern "C" bool CompareExchange(void* val, uint64_t compare, uint64_t newValue);
+extern "C" uint64_t Exchange(void* val, uint64_t newValue);
\ No newline at end of file
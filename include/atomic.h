@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+enum class MemoryOrder : int {
+    RELAXED = __ATOMIC_RELAXED,
+    ACQUIRE = __ATOMIC_ACQUIRE,
+    RELEASE = __ATOMIC_RELEASE,
+    ACQUIRE_RELEASE = __ATOMIC_ACQ_REL,
+    SEQUENTIAL = __ATOMIC_SEQ_CST,
+};
+
+// A value shared with other processes or interrupt handlers, so the compiler can neither cache nor reorder it
+// T must be an integer, bool or pointer, only integers can be added to
+template <class T> class Atomic {
+    T value;
+
+    // A failed compare exchange only loads, so it can't have release semantics
+    static constexpr int FailureOrder(MemoryOrder order) {
+        if (order == MemoryOrder::RELEASE)
+            return __ATOMIC_RELAXED;
+        if (order == MemoryOrder::ACQUIRE_RELEASE)
+            return __ATOMIC_ACQUIRE;
+        return (int)order;
+    }
+
+public:
+    constexpr Atomic(T initial = T()) : value(initial) {}
+
+    Atomic(const Atomic&) = delete;
+    Atomic& operator=(const Atomic&) = delete;
+
+    inline T load(MemoryOrder order = MemoryOrder::SEQUENTIAL) const { return __atomic_load_n(&value, (int)order); }
+    inline void store(T newValue, MemoryOrder order = MemoryOrder::SEQUENTIAL) { __atomic_store_n(&value, newValue, (int)order); }
+
+    // Return the previous value
+    inline T exchange(T newValue, MemoryOrder order = MemoryOrder::SEQUENTIAL) { return __atomic_exchange_n(&value, newValue, (int)order); }
+    inline T fetch_add(T delta, MemoryOrder order = MemoryOrder::SEQUENTIAL) { return __atomic_fetch_add(&value, delta, (int)order); }
+    inline T fetch_sub(T delta, MemoryOrder order = MemoryOrder::SEQUENTIAL) { return __atomic_fetch_sub(&value, delta, (int)order); }
+
+    // On failure expected is updated to the current value
+    inline bool compare_exchange(T& expected, T desired, MemoryOrder order = MemoryOrder::SEQUENTIAL) { return __atomic_compare_exchange_n(&value, &expected, desired, false, (int)order, FailureOrder(order)); }
+};
\ No newline at end of file
@@ -9,6 +9,8 @@
 #define BACKGROUND_COLOR_ADDRESS 0x03
 #define CLEAR_SCREEN_ADDRESS 0x05
 
+#define CONSOLE_LOG_SIZE 16384
+
 namespace Console {
     void SetStdOutput(Device::Device* device);
     void SetStdInput(Device::Device* device);
@@ -18,6 +20,10 @@ namespace Console {
 
     int64_t Read(void* buffer, int64_t count);
 
+    // Copies kernel output that hasn't been read yet
+    // Output is dropped while the log is full, and the next read is followed by a notice of how much
+    int64_t ReadLog(void* buffer, int64_t count);
+
     void SetForegroundColor(uint8_t red, uint8_t green, uint8_t blue);
     void SetBackgroundColor(uint8_t red, uint8_t green, uint8_t blue);
 
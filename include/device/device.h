@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic.h>
+#include <list.h>
 #include <mutex.h>
 #include <queue.h>
+#include <spinlock.h>
 #include <stdint.h>
+#include <waitqueue.h>
 
 namespace Device {
     class Device {
@@ -19,7 +23,9 @@ namespace Device {
         virtual int64_t WriteStream(uint64_t address, void* buffer, int64_t count);
 
         void AddChild(Device* child);
-        uint64_t FindDevices(Type type, Queue<Device>& queue);
+        // Must be called inside an RCU read section, so matches go into the caller's array instead of allocating
+        // Returns found plus the matches in this subtree, only the first maximum are stored
+        uint64_t FindDevices(Type type, Device** devices, uint64_t maximum, uint64_t found);
         void RemoveChild(Device* child);
 
         const char* GetName();
@@ -29,6 +35,9 @@ namespace Device {
         void IncreamentRefCount();
         void DecreamentRefCount();
 
+        // Links the device into its parent's children or the root device list
+        ListNode<Device> siblingNode;
+
     protected:
         void SetName(const char* newName);
 
@@ -36,10 +45,14 @@ namespace Device {
         char* name;
         Type type;
 
-        uint64_t refCount;
+        // The destructor sleeps until the last reference is dropped, only dropping the last one takes the lock
+        Atomic<uint64_t> refCount;
+        Spinlock refLock;
+        WaitQueue refQueue;
 
         Device* parent;
-        Queue<Device> children;
+        // Read under RCU, the mutex only serializes writers
+        List<Device> children;
         Mutex childrenMutex;
     };
 } // namespace Device
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic.h>
 #include <device/device.h>
 #include <device/drivers/pci.h>
+#include <spinlock.h>
+#include <waitqueue.h>
 
 class ATAPIDevice;
 class ATADevice;
@@ -31,7 +34,9 @@ private:
         Mutex mutex;
     } channels[2];
 
-    bool irq;
+    Atomic<bool> irq;
+    Spinlock irqLock;
+    WaitQueue irqQueue;
 };
 
 class ATAPIDevice : public Device::Device {
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <atomic.h>
 #include <device/device.h>
+#include <ringbuffer.h>
+#include <spinlock.h>
+#include <waitqueue.h>
+
+#define PS2_BUFFER_SIZE 256
 
 class PS2Keyboard;
 
@@ -20,9 +26,20 @@ private:
 
     void IdentPort(uint64_t port);
 
+    // Wakes the port's queue
+    void SignalPort(uint64_t port);
+
     bool portExists[2];
-    bool portIRQ[2];
+    Atomic<bool> portIRQ[2];
     uint8_t portData[2];
+
+    // Guards portIRQ and the buffers against the IRQ handlers
+    Spinlock portLock;
+    WaitQueue portQueue[2];
+
+    // Once a device driver owns a port, its IRQ fills the buffer instead of portData
+    bool portBuffered[2];
+    RingBuffer<uint8_t, PS2_BUFFER_SIZE> portBuffer[2];
 };
 
 class PS2Keyboard : public Device::Device {
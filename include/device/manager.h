@@ -4,9 +4,11 @@
 
 namespace Device {
     uint64_t RegisterDevice(Device* parent, Device* newDevice);
+    // Returns once no walk of the device tree can still reach the device, so it can be deleted
     void UnregisterDevice(Device* device);
 
-    uint64_t GetDevices(Device::Type type, Queue<Device>& queue);
+    // Stores up to maximum matching devices, returns how many there are in total
+    uint64_t GetDevices(Device::Type type, Device** devices, uint64_t maximum);
 
     int Open(Device* device);
     void Close(int dd);
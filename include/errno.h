@@ -14,6 +14,7 @@
 
 // Synchronization Errors
 #define ERROR_NOT_OWNER 0x10
+#define ERROR_VALUE_CHANGED 0x11
 
 // Other Errors
 #define ERROR_ACPI_ERROR 0x20
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic.h>
 #include <device/device.h>
+#include <hashmap.h>
+#include <list.h>
 
 #define DIRENT_TYPE_FILE 0
 #define DIRENT_TYPE_DIRECTORY 1
@@ -33,6 +36,8 @@ private:
 };
 
 class File {
+    friend Directory;
+
 public:
     File(const char* name, int64_t size, Directory* directory, Filesystem* filesystem, uint64_t flags = 0);
 
@@ -55,9 +60,11 @@ private:
     Directory* directory;
     Filesystem* filesystem;
 
-    uint64_t refCount;
+    Atomic<uint64_t> refCount;
 
     uint64_t flags;
+
+    ListNode<File> directoryNode;
 };
 
 class Directory {
@@ -66,11 +73,19 @@ class Directory {
 public:
     Directory(const char* name, Directory* parent, Filesystem* filesystem);
 
+    // Derived directories must provide their own, the cache only fits a Directory and panics otherwise
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
     void AddSubDirectory(Directory* directory);
     void AddSubFile(File* file);
 
-    Queue<Directory>* GetSubDirectories();
-    Queue<File>* GetFiles();
+    List<Directory>* GetSubDirectories();
+    List<File>* GetFiles();
+
+    // Return nullptr if there is no entry with the name, which doesn't need to be null terminated
+    Directory* FindSubDirectory(const char* name, uint64_t length);
+    File* FindFile(const char* name, uint64_t length);
     const char* GetName();
     char* GetFullName();
     Directory* GetParent();
@@ -84,8 +99,16 @@ private:
     Directory* parent;
     Filesystem* filesystem;
 
-    Queue<Directory> subDirectories;
-    Queue<File> files;
+    // Filled in before the filesystem is registered, path walks then read them without locks
+    List<Directory> subDirectories;
+    List<File> files;
+
+    // Keyed by the names the entries own
+    // Inserting can move the table, so these must not change once readers can see the directory
+    HashMap<StringKey, Directory*> subDirectoryNames;
+    HashMap<StringKey, File*> fileNames;
+
+    ListNode<Directory> siblingNode;
 };
 
 class Filesystem {
@@ -124,6 +147,9 @@ private:
 struct FileDescriptor {
     FileDescriptor(File* file, int flags);
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
     File* file;
     int64_t offset;
 
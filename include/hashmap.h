@@ -0,0 +1,197 @@
+#pragma once
+
+#include <memory/heap.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HASH_MAP_MINIMUM_CAPACITY 16
+
+// Names that aren't null terminated, such as path components, can be looked up without copying
+struct StringKey {
+    const char* string;
+    uint64_t length;
+
+    inline bool operator==(const StringKey& other) const { return length == other.length && memcmp(string, other.string, length) == 0; }
+};
+
+inline uint64_t HashKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCD;
+    key ^= key >> 33;
+    return key;
+}
+
+// FNV-1a
+inline uint64_t HashKey(const StringKey& key) {
+    uint64_t hash = 0xCBF29CE484222325;
+    for (uint64_t i = 0; i < key.length; i++) {
+        hash ^= (uint8_t)key.string[i];
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+// Robin Hood hash map, K and V must be trivially copyable
+// K needs a HashKey overload and operator==
+template <class K, class V> class HashMap {
+    struct Entry {
+        K key;
+        V value;
+        uint64_t distance; // Probe distance plus one, zero if the slot is empty
+    };
+
+    Entry* entries;
+    uint64_t capacity;
+    uint64_t size;
+
+public:
+    constexpr HashMap() : entries(nullptr), capacity(0), size(0) {}
+    ~HashMap() { Memory::Heap::Free(entries); }
+
+    HashMap(const HashMap&) = delete;
+    HashMap& operator=(const HashMap&) = delete;
+
+    // Returns false if the key is already present
+    bool insert(const K& key, const V& value) {
+        if (find(key) != nullptr)
+            return false;
+
+        // Keep the load factor under 7/8
+        if ((size + 1) * 8 > capacity * 7)
+            Grow(capacity == 0 ? HASH_MAP_MINIMUM_CAPACITY : capacity * 2);
+
+        Place(key, value);
+        size++;
+        return true;
+    }
+
+    // Returns nullptr if the key isn't present
+    V* find(const K& key) {
+        uint64_t index = FindIndex(key);
+        if (index == capacity)
+            return nullptr;
+
+        return &entries[index].value;
+    }
+
+    // Returns false if the key isn't present
+    bool remove(const K& key) {
+        uint64_t index = FindIndex(key);
+        if (index == capacity)
+            return false;
+
+        // Shift the following entries back instead of leaving a tombstone
+        uint64_t mask = capacity - 1;
+        uint64_t next = (index + 1) & mask;
+        while (entries[next].distance > 1) {
+            entries[index] = entries[next];
+            entries[index].distance--;
+
+            index = next;
+            next = (next + 1) & mask;
+        }
+
+        entries[index].distance = 0;
+        size--;
+        return true;
+    }
+
+    inline uint64_t count() { return size; }
+
+    class Iterator {
+    public:
+        K* key;
+        V* value;
+
+        // Starts before the first entry, call Next to reach it
+        Iterator(HashMap* map) : key(nullptr), value(nullptr), map(map), index(0) {}
+
+        bool Next() {
+            for (; index < map->capacity; index++) {
+                if (map->entries[index].distance == 0)
+                    continue;
+
+                key = &map->entries[index].key;
+                value = &map->entries[index].value;
+                index++;
+                return true;
+            }
+
+            key = nullptr;
+            value = nullptr;
+            return false;
+        }
+
+    private:
+        HashMap* map;
+        uint64_t index;
+    };
+
+private:
+    // Returns capacity if the key isn't present
+    uint64_t FindIndex(const K& key) {
+        if (size == 0)
+            return capacity;
+
+        uint64_t mask = capacity - 1;
+        uint64_t index = HashKey(key) & mask;
+        for (uint64_t distance = 1;; distance++) {
+            Entry* entry = &entries[index];
+
+            // A richer entry means the key would have displaced it
+            if (entry->distance < distance)
+                return capacity;
+
+            if (entry->key == key)
+                return index;
+
+            index = (index + 1) & mask;
+        }
+    }
+
+    void Grow(uint64_t newCapacity) {
+        Entry* oldEntries = entries;
+        uint64_t oldCapacity = capacity;
+
+        entries = (Entry*)Memory::Heap::Allocate(newCapacity * sizeof(Entry));
+        memset(entries, 0, newCapacity * sizeof(Entry));
+        capacity = newCapacity;
+
+        for (uint64_t i = 0; i < oldCapacity; i++)
+            if (oldEntries[i].distance != 0)
+                Place(oldEntries[i].key, oldEntries[i].value);
+
+        Memory::Heap::Free(oldEntries);
+    }
+
+    // Assumes the key isn't present and there is a free slot
+    void Place(K key, V value) {
+        uint64_t mask = capacity - 1;
+        uint64_t index = HashKey(key) & mask;
+        uint64_t distance = 1;
+        while (true) {
+            Entry* entry = &entries[index];
+            if (entry->distance == 0) {
+                entry->key = key;
+                entry->value = value;
+                entry->distance = distance;
+                return;
+            }
+
+            // Take the slot from a richer entry and carry it forward
+            if (entry->distance < distance) {
+                Entry displaced = *entry;
+                entry->key = key;
+                entry->value = value;
+                entry->distance = distance;
+
+                key = displaced.key;
+                value = displaced.value;
+                distance = displaced.distance;
+            }
+
+            index = (index + 1) & mask;
+            distance++;
+        }
+    }
+};
\ No newline at end of file
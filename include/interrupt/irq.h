@@ -14,4 +14,20 @@ namespace Interrupt {
     // Returns the context for the irq
     // Returns nullptr if no irq is installed
     void* RemoveIRQHandler(uint8_t irq);
+
+    // Disables interrupts on this processor
+    // Returns the previous flags to be passed to Restore
+    inline uint64_t Disable() {
+        uint64_t flags;
+        asm volatile("pushfq; pop %0; cli" : "=r"(flags) : : "memory");
+        return flags;
+    }
+
+    // Sets the interrupt flag exactly as saved, a process may be switched back in with a different state
+    inline void Restore(uint64_t flags) {
+        if (flags & (1 << 9))
+            asm volatile("sti" : : : "memory");
+        else
+            asm volatile("cli" : : : "memory");
+    }
 } // namespace Interrupt
\ No newline at end of file
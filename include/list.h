@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdint.h>
+
+// Embedded in the objects a List holds, so pushing never allocates
+// A node can only be on one list at a time
+template <class T> struct ListNode {
+    ListNode* next;
+    ListNode* prev;
+    T* value;
+};
+
+template <class T> class List {
+    ListNode<T>* head;
+    ListNode<T>* tail;
+    uint64_t size;
+
+public:
+    constexpr List() : head(nullptr), tail(nullptr), size(0) {}
+
+    inline void push(T* value, ListNode<T>* node) {
+        node->value = value;
+        node->next = nullptr;
+        node->prev = tail;
+
+        if (tail == nullptr)
+            head = node;
+        else
+            tail->next = node;
+
+        tail = node;
+        size++;
+    }
+
+    // For lists read under RCU, the node is filled in before it becomes reachable
+    // Writers still need a lock between them
+    inline void publish(T* value, ListNode<T>* node) {
+        node->value = value;
+        node->next = nullptr;
+        node->prev = tail;
+        asm volatile("" : : : "memory");
+
+        if (tail == nullptr)
+            head = node;
+        else
+            tail->next = node;
+
+        tail = node;
+        size++;
+    }
+
+    // Leaves the node's next pointer intact, so a reader standing on it can carry on
+    // The node can't be reused until a grace period has passed
+    inline void unpublish(ListNode<T>* node) {
+        if (node->prev != nullptr)
+            node->prev->next = node->next;
+        else
+            head = node->next;
+
+        if (node->next != nullptr)
+            node->next->prev = node->prev;
+        else
+            tail = node->prev;
+
+        size--;
+    }
+
+    inline void pop() {
+        if (head != nullptr)
+            remove(head);
+    }
+
+    inline void remove(ListNode<T>* node) {
+        if (node->prev != nullptr)
+            node->prev->next = node->next;
+        else
+            head = node->next;
+
+        if (node->next != nullptr)
+            node->next->prev = node->prev;
+        else
+            tail = node->prev;
+
+        node->next = nullptr;
+        node->prev = nullptr;
+        size--;
+    }
+
+    inline T* front() {
+        if (head == nullptr)
+            return nullptr;
+
+        return head->value;
+    }
+
+    inline T* back() {
+        if (tail == nullptr)
+            return nullptr;
+
+        return tail->value;
+    }
+
+    inline uint64_t count() { return size; }
+
+    class Iterator {
+    public:
+        T* value;
+
+        Iterator(List<T>* list) : list(list) {
+            currentNode = list->head;
+            value = currentNode != nullptr ? currentNode->value : nullptr;
+        }
+
+        bool Next() {
+            if (currentNode == nullptr || currentNode->next == nullptr)
+                return false;
+
+            currentNode = currentNode->next;
+            value = currentNode->value;
+            return true;
+        }
+
+        bool Prev() {
+            if (currentNode == nullptr || currentNode->prev == nullptr)
+                return false;
+
+            currentNode = currentNode->prev;
+            value = currentNode->value;
+            return true;
+        }
+
+        // Moves to the next node, or the previous one at the end of the list
+        bool Remove() {
+            ListNode<T>* newNode = currentNode->next != nullptr ? currentNode->next : currentNode->prev;
+            list->remove(currentNode);
+
+            currentNode = newNode;
+            value = currentNode != nullptr ? currentNode->value : nullptr;
+
+            return currentNode != nullptr;
+        }
+
+    private:
+        ListNode<T>* currentNode;
+        List* list;
+    };
+};
\ No newline at end of file
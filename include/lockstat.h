@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+// Define LOCK_STATS to record acquisitions, contention, wait and hold times for every Mutex, Spinlock and RWLock
+#define LOCK_STATS_MAX 1024
+
+inline uint64_t ReadTSC() {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+#ifdef LOCK_STATS
+// Lives inside the lock it measures, only the holder writes it so the lock protects its own counters
+// An RWLock only records its writers, as several readers hold it at once
+struct LockStats {
+    constexpr LockStats(const char* name) : name(name), acquisitions(0), contended(0), totalWait(0), maxWait(0), maxHold(0), holdStart(0), registered(false) {}
+    ~LockStats();
+
+    // start is the TSC when the acquirer began waiting
+    void Acquired(uint64_t start, bool wasContended);
+    void Released();
+
+    const char* name;
+
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t totalWait; // TSC cycles
+    uint64_t maxWait;
+    uint64_t maxHold;
+
+    uint64_t holdStart;
+    bool registered;
+};
+#endif
+
+// Prints the most contended locks, returns the number of locks tracked
+// Kernels built without LOCK_STATS return ~0
+uint64_t PrintLockStats(uint64_t numLocks);
\ No newline at end of file
@@ -8,6 +8,7 @@
 #define TERABYTE (1024 * GIGABYTE)
 
 #define PAGE_SIZE (4 * KILOBYTE)
+#define LARGE_PAGE_SIZE (2 * MEGABYTE)
 
 #define KERNEL_LMA 0x100000
 #define KERNEL_VMA 0xFFFF800000000000
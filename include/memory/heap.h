@@ -3,8 +3,17 @@
 #include <stdint.h>
 
 namespace Memory { namespace Heap {
+    // Refilling or shrinking a size class maps pages and may sleep
+    // So the heap can't be used from interrupt handlers or with interrupts disabled
     void* Allocate(uint64_t size);
     void* AllocateAligned(uint64_t size, uint64_t alignment);
 
     void Free(void* ptr);
+
+    // Grows or shrinks an allocation, in place when possible, keeping its contents up to the smaller size
+    void* Reallocate(void* ptr, uint64_t size);
+
+    // Prints the heaviest call sites by live bytes and every site with allocations older than minimumAge milliseconds
+    // Returns the number of live allocations, kernels built without HEAP_PROFILE return ~0
+    uint64_t PrintProfile(uint64_t numSites, uint64_t minimumAge);
 }} // namespace Memory::Heap
\ No newline at end of file
@@ -5,9 +5,16 @@
 namespace Memory { namespace Physical {
     void Allocate(PhysicalAddress addr);
     PhysicalAddress Allocate();
+    // Allocates a whole free LARGE_PAGE_SIZE block, returns 0 if there is none
+    PhysicalAddress AllocateLarge();
 
     void Free(PhysicalAddress addr);
 
+    // Migrates user pages to assemble up to numBlocks free LARGE_PAGE_SIZE blocks
+    // Returns the number of blocks assembled, or ~0 if the last pass was too recent
+    uint64_t Compact(uint64_t numBlocks);
+    void PrintCompactionStats();
+
     uint64_t GetTotalPages();
     uint64_t GetFreePages();
 }} // namespace Memory::Physical
\ No newline at end of file
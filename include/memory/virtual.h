@@ -10,6 +10,22 @@ namespace Memory { namespace Virtual {
 
     void Free(VirtualAddress virt);
 
+    // Returns 0 if virt isn't mapped in the current address space
+    PhysicalAddress GetPhysicalAddress(VirtualAddress virt);
+
+    void AllocatePages(VirtualAddress virt, uint64_t numPages);
+    void FreePages(VirtualAddress virt, uint64_t numPages);
+
+    // Reserves a range of the kernel range region and maps it before returning
+    void* AllocateKernelRange(uint64_t numPages);
+    void FreeKernelRange(void* ptr);
+
+    // Returns the number of usable pages in the range starting at ptr
+    uint64_t GetKernelRangePages(void* ptr);
+
+    // Grows the range in place to numPages if the space after it is free
+    bool ExtendKernelRange(void* ptr, uint64_t numPages);
+
     PhysicalAddress CreateAddressSpace();
     void DeletePagingStructure(PhysicalAddress structure);
 
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <asm.h>
+#include <stdint.h>
+
+// Embedded in the objects an MPSCQueue holds, a node can only be queued once at a time
+template <class T> struct MPSCNode {
+    MPSCNode* volatile next;
+    T* value;
+};
+
+// Intrusive multi-producer single-consumer queue
+// push never locks or allocates and is safe from interrupt handlers, pop must only be called by one consumer at a time
+template <class T> class MPSCQueue {
+    MPSCNode<T>* volatile head;
+    MPSCNode<T>* tail;
+    MPSCNode<T> stub;
+
+public:
+    constexpr MPSCQueue() : head(&stub), tail(&stub), stub{nullptr, nullptr} {}
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    inline void push(T* value, MPSCNode<T>* node) {
+        node->value = value;
+        push(node);
+    }
+
+    // Returns nullptr if the queue is empty or a producer is midway through a push
+    T* pop() {
+        MPSCNode<T>* current = tail;
+        MPSCNode<T>* next = current->next;
+
+        if (current == &stub) {
+            if (next == nullptr)
+                return nullptr;
+
+            tail = next;
+            current = next;
+            next = next->next;
+        }
+
+        if (next != nullptr) {
+            tail = next;
+            return current->value;
+        }
+
+        if (current != head)
+            return nullptr;
+
+        // current is the last node, put the stub behind it so it can be unlinked
+        push(&stub);
+
+        next = current->next;
+        if (next == nullptr)
+            return nullptr;
+
+        tail = next;
+        return current->value;
+    }
+
+private:
+    inline void push(MPSCNode<T>* node) {
+        node->next = nullptr;
+        MPSCNode<T>* prev = (MPSCNode<T>*)Exchange((void*)&head, (uint64_t)node);
+        prev->next = node;
+    }
+};
\ No newline at end of file
@@ -1,20 +1,54 @@
 #pragma once
 
-#include <queue.h>
+#include <list.h>
+#include <lockstat.h>
+#include <spinlock.h>
+#include <waitqueue.h>
+
+// Bounds the spin in case the owner never stops running
+#define MUTEX_SPIN_LIMIT 1000
+
+// Set in the owner word while processes are waiting, so Unlock takes the slow path
+#define MUTEX_WAITERS 1
 
 class Process;
 
+struct MutexStats {
+    uint64_t uncontended; // Taken without spinning or sleeping
+    uint64_t spun; // Acquired after spinning on a running owner, without sleeping
+    uint64_t slept;
+};
+
 class Mutex {
 public:
-    Mutex();
+    Mutex(const char* name = nullptr);
 
     void Lock();
     void Unlock();
 
     Process* GetOwner();
+    MutexStats GetStats();
+
+    // Changes a process's own priority, keeping whatever it inherits through the mutexes it holds
+    // Priorities above PROCESS_MAXIMUM_PRIORITY are clamped
+    static void SetPriority(Process* process, uint64_t priority);
 
 private:
-    Process* owner;
+    static void Boost(Process* owner, uint64_t priority);
+    static void RestorePriority(Process* process);
+
+    uint64_t owner;
+    MutexStats stats;
+
+    Spinlock lock;
+    WaitQueue waiters;
+
+    // Priority inheritance, guarded by priorityLock
+    // The highest priority among the waiters, and the node on the owner's list while there are any
+    uint64_t waiterPriority;
+    ListNode<Mutex> heldNode;
 
-    Queue<Process> waitlist;
+#ifdef LOCK_STATS
+    LockStats lockStats;
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <spinlock.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_LINE_SIZE 64
+
+inline void* operator new(size_t, void* ptr) { return ptr; }
+
+struct ObjectCacheStats {
+    uint64_t objectSize;
+    uint64_t slotSize;
+
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t inUse;
+    uint64_t maximumInUse;
+
+    uint64_t chunks;
+};
+
+// Hands out fixed size slots from chunks it keeps forever, so reuse is a free list pop
+// Slots are cache line aligned, smaller objects are packed in power of two slots so none straddle a line
+class ObjectCacheBase {
+public:
+    constexpr ObjectCacheBase(uint64_t objectSize) : slotSize(GetSlotSize(objectSize)), freeList(nullptr), stats{objectSize, GetSlotSize(objectSize), 0, 0, 0, 0, 0} {}
+
+    void* Allocate();
+    void Free(void* ptr);
+
+    // For class operator new, panics if size doesn't match the object size
+    // A derived class without its own operator new would otherwise overflow the slot
+    void* Allocate(size_t size);
+
+    ObjectCacheStats GetStats();
+
+private:
+    static constexpr uint64_t GetSlotSize(uint64_t size) {
+        if (size >= CACHE_LINE_SIZE)
+            return (size + CACHE_LINE_SIZE - 1) & ~(uint64_t)(CACHE_LINE_SIZE - 1);
+
+        uint64_t slotSize = sizeof(void*);
+        while (slotSize < size)
+            slotSize <<= 1;
+        return slotSize;
+    }
+
+    void Grow();
+
+    uint64_t slotSize;
+
+    void* freeList;
+
+    ObjectCacheStats stats;
+    Spinlock lock;
+};
+
+template <class T> class ObjectCache : public ObjectCacheBase {
+public:
+    constexpr ObjectCache() : ObjectCacheBase(sizeof(T)) {}
+
+    template <class... Args> T* New(Args... args) { return new (Allocate()) T(args...); }
+
+    void Delete(T* object) {
+        if (object == nullptr)
+            return;
+
+        object->~T();
+        Free(object);
+    }
+};
\ No newline at end of file
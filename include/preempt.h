@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// There is one processor, so one count for it
+// The timer only preempts while it is zero, and nothing may sleep while it isn't
+extern volatile uint64_t preemptCount;
+
+// Set when the timer found the count non-zero
+extern volatile bool preemptPending;
+
+void PreemptDeferred();
+
+// Nestable, spinlocks keep preemption disabled while they are held
+inline void PreemptDisable() {
+    preemptCount++;
+    asm volatile("" : : : "memory");
+}
+
+// Takes a preemption the timer deferred once the count drops to zero
+inline void PreemptEnable() {
+    asm volatile("" : : : "memory");
+    if (--preemptCount == 0 && preemptPending)
+        PreemptDeferred();
+}
\ No newline at end of file
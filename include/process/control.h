@@ -4,9 +4,29 @@
 
 #include <process/process.h>
 
+struct DeferredWork {
+    void (*function)(void* context);
+    void* context;
+
+    MPSCNode<DeferredWork> node;
+    uint64_t queued;
+};
+
 void Yield();
+
+// Safe from interrupt handlers, the process joins the run queue on the next pass through the scheduler
 void QueueExecution(Process* process);
 
+// Must be called with interrupts disabled after changing a process's priority, moves it to the matching run list
+void PriorityChanged(Process* process);
+
+// Safe from interrupt handlers, does nothing if the work is already queued
+// The work runs on the next pass through the scheduler with interrupts disabled and must not block
+void Defer(DeferredWork* work);
+
+// Frees processes that have exited, freeing may sleep so this must be called from process context with no locks held
+void ReapProcesses();
+
 uint64_t Execute(const char* filepath, const char** args, const char** env);
 
 uint64_t Wait(uint64_t pid);
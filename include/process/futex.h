@@ -0,0 +1,20 @@
+#pragma once
+
+#include <memory/defs.h>
+#include <stdint.h>
+#include <time.h>
+
+#define FUTEX_HASH_SIZE 64
+
+// Sleeps while the 32 bit word at address holds expected, a timeout of 0 waits forever
+// Returns SUCCESS once woken, ERROR_VALUE_CHANGED if the word didn't hold expected or ERROR_TIMEOUT
+uint64_t FutexWait(uint32_t* address, uint32_t expected, time_t timeout);
+
+// Returns the number of processes woken
+uint64_t FutexWake(uint32_t* address, uint64_t count);
+
+// Keys are physical addresses, so compaction must not move a page a process is asleep on
+// Both must be called with interrupts disabled, which keeps waiters from queueing in between
+bool FutexPageHasWaiters(PhysicalAddress page);
+// Makes waiters that translated their key before the move translate it again
+void FutexPageMoved();
\ No newline at end of file
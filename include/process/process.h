@@ -1,23 +1,38 @@
 #pragma once
 
+#include <arena.h>
 #include <device/device.h>
 #include <filesystem/driver.h>
+#include <hashmap.h>
+#include <list.h>
 #include <memory/defs.h>
+#include <mpscqueue.h>
 #include <mutex.h>
-#include <queue.h>
+#include <rwlock.h>
+#include <slottable.h>
 #include <stdint.h>
+#include <waitqueue.h>
 
 #define KERNEL_STACK_SIZE 32768
-#define PROCESS_HASH_SIZE 1024
+
+// Higher priorities run first, new processes take their creator's base priority
+// Priorities above the default are reserved for the kernel, user processes may only lower theirs
+#define PROCESS_MINIMUM_PRIORITY 0
+#define PROCESS_DEFAULT_PRIORITY 16
+#define PROCESS_MAXIMUM_PRIORITY 31
+
+// runPriority of a process that isn't on a run list
+#define PROCESS_NOT_RUNNABLE ~(uint64_t)0
 
 extern "C" void SetKernelProcess();
 
 struct Process {
-    enum State { NORMAL, UNINTERRUPTABLE };
-
     Process(const char* name);
     ~Process();
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
     uint64_t kernelStackPointer;
     uint8_t* stack;
     uint64_t userStackPointer;
@@ -28,23 +43,48 @@ struct Process {
     PhysicalAddress pagingStructure;
     Mutex pagingStructureMutex;
 
-    Queue<Process> exit;
+    // The address space switched to when the process runs, its own unless Execute has borrowed a new process's
+    PhysicalAddress addressSpace;
+    Mutex* addressSpaceMutex;
+
+    // Links the process into the run queue or a wait queue, a process is only ever on one of them
+    ListNode<Process> queueNode;
+    MPSCNode<Process> wakeupNode;
+    Waiter wait;
+
+    // Processes waiting for this one to exit
+    WaitQueue exit;
+    Spinlock exitLock;
     uint64_t queueData;
 
     uint64_t errno;
 
-    Device::Device** devices;
-    uint64_t devicesLength;
+    SlotTable<Device::Device> devices;
+    SlotTable<FileDescriptor> files;
+
+    // Set while the process is on a processor
+    volatile bool running;
 
-    FileDescriptor** files;
-    uint64_t filesLength;
+    // The scheduler runs the highest priority first, priority is basePriority raised by the mutex waiters it holds up
+    uint64_t priority;
+    uint64_t basePriority;
+    // The run list the process is on, only touched with interrupts disabled
+    uint64_t runPriority;
 
-    State state;
+    // Priority inheritance state, guarded by the mutex priority lock
+    Mutex* blockedOn;
+    List<Mutex> heldMutexes; // Held mutexes with waiters
+
+    // RCU read section depth
+    uint64_t rcuNesting;
 
     Directory* currentDirectory;
 
     void* floatingPoint;
 
+    // Scratch memory for system calls
+    Arena arena;
+
     friend void ::SetKernelProcess();
 
     uint64_t AddDevice(Device::Device* device);
@@ -60,5 +100,5 @@ struct Process {
 extern Process* currentProcess;
 extern Process kernelProcess;
 
-extern Mutex processHashMutex;
-extern Queue<Process> processHash[PROCESS_HASH_SIZE];
\ No newline at end of file
+extern RWLock processHashLock;
+extern HashMap<uint64_t, Process*> processHash;
\ No newline at end of file
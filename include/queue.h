@@ -1,12 +1,19 @@
 #pragma once
 
+#include <objectcache.h>
 #include <stdint.h>
 
+// Shared by every Queue as their nodes are all three pointers
+extern ObjectCacheBase queueNodeCache;
+
 template <class T> class Queue {
     struct Node {
         Node* next;
         Node* prev;
         T* val;
+
+        static void* operator new(size_t size) { return queueNodeCache.Allocate(size); }
+        static void operator delete(void* ptr) { queueNodeCache.Free(ptr); }
     };
 
     Node* head;
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <memory/heap.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RADIX_TREE_BITS 6
+#define RADIX_TREE_FANOUT (1 << RADIX_TREE_BITS)
+#define RADIX_TREE_MAX_SPARE 8
+
+struct RadixNode {
+    void* slots[RADIX_TREE_FANOUT];
+    uint64_t present; // One bit per non-null slot
+};
+
+// Sparse map from integer keys to values, such as page or block indices to cache entries
+// Nodes are recycled through a small spare list, reserve fills it ahead of time so later inserts don't touch the heap
+template <class T> class RadixTree {
+    RadixNode* root;
+    uint64_t shift; // Key shift of the root's slots
+    uint64_t size;
+
+    RadixNode* spare; // Linked through slots[0]
+    uint64_t spareCount;
+
+public:
+    constexpr RadixTree() : root(nullptr), shift(0), size(0), spare(nullptr), spareCount(0) {}
+
+    ~RadixTree() {
+        if (root != nullptr)
+            FreeNode(root, shift);
+
+        while (spare != nullptr) {
+            RadixNode* node = spare;
+            spare = (RadixNode*)node->slots[0];
+            Memory::Heap::Free(node);
+        }
+    }
+
+    RadixTree(const RadixTree&) = delete;
+    RadixTree& operator=(const RadixTree&) = delete;
+
+    // Makes sure count nodes are available without allocating
+    void reserve(uint64_t count) {
+        while (spareCount < count) {
+            RadixNode* node = (RadixNode*)Memory::Heap::Allocate(sizeof(RadixNode));
+            node->slots[0] = spare;
+            spare = node;
+            spareCount++;
+        }
+    }
+
+    // Returns false if the key is already present
+    bool insert(uint64_t key, T* value) {
+        if (root == nullptr) {
+            root = NewNode();
+            shift = 0;
+        }
+
+        // Add levels on top until the key fits
+        while (shift + RADIX_TREE_BITS < 64 && (key >> (shift + RADIX_TREE_BITS)) != 0) {
+            RadixNode* node = NewNode();
+            node->slots[0] = root;
+            node->present = 1;
+
+            root = node;
+            shift += RADIX_TREE_BITS;
+        }
+
+        RadixNode* node = root;
+        for (uint64_t s = shift; s > 0; s -= RADIX_TREE_BITS) {
+            uint64_t index = (key >> s) & (RADIX_TREE_FANOUT - 1);
+            if (node->slots[index] == nullptr) {
+                node->slots[index] = NewNode();
+                node->present |= (uint64_t)1 << index;
+            }
+
+            node = (RadixNode*)node->slots[index];
+        }
+
+        uint64_t index = key & (RADIX_TREE_FANOUT - 1);
+        if (node->slots[index] != nullptr)
+            return false;
+
+        node->slots[index] = value;
+        node->present |= (uint64_t)1 << index;
+        size++;
+        return true;
+    }
+
+    // Returns nullptr if the key isn't present
+    T* find(uint64_t key) {
+        if (root == nullptr || (shift + RADIX_TREE_BITS < 64 && (key >> (shift + RADIX_TREE_BITS)) != 0))
+            return nullptr;
+
+        RadixNode* node = root;
+        for (uint64_t s = shift; node != nullptr; s -= RADIX_TREE_BITS) {
+            void* slot = node->slots[(key >> s) & (RADIX_TREE_FANOUT - 1)];
+            if (s == 0)
+                return (T*)slot;
+
+            node = (RadixNode*)slot;
+        }
+
+        return nullptr;
+    }
+
+    // Returns the removed value, or nullptr if the key isn't present
+    T* remove(uint64_t key) {
+        if (root == nullptr || (shift + RADIX_TREE_BITS < 64 && (key >> (shift + RADIX_TREE_BITS)) != 0))
+            return nullptr;
+
+        RadixNode* path[64 / RADIX_TREE_BITS + 1];
+        uint64_t depth = 0;
+
+        RadixNode* node = root;
+        for (uint64_t s = shift; s > 0; s -= RADIX_TREE_BITS) {
+            path[depth++] = node;
+            node = (RadixNode*)node->slots[(key >> s) & (RADIX_TREE_FANOUT - 1)];
+            if (node == nullptr)
+                return nullptr;
+        }
+
+        uint64_t index = key & (RADIX_TREE_FANOUT - 1);
+        T* value = (T*)node->slots[index];
+        if (value == nullptr)
+            return nullptr;
+
+        node->slots[index] = nullptr;
+        node->present &= ~((uint64_t)1 << index);
+        size--;
+
+        // Release nodes that became empty, bottom up
+        uint64_t s = 0;
+        while (node->present == 0 && depth > 0) {
+            ReleaseNode(node);
+
+            s += RADIX_TREE_BITS;
+            node = path[--depth];
+            index = (key >> s) & (RADIX_TREE_FANOUT - 1);
+            node->slots[index] = nullptr;
+            node->present &= ~((uint64_t)1 << index);
+        }
+
+        if (root->present == 0) {
+            ReleaseNode(root);
+            root = nullptr;
+            return value;
+        }
+
+        // Drop levels that only lead to slot zero
+        while (shift > 0 && root->present == 1) {
+            RadixNode* oldRoot = root;
+            root = (RadixNode*)root->slots[0];
+            shift -= RADIX_TREE_BITS;
+            ReleaseNode(oldRoot);
+        }
+
+        return value;
+    }
+
+    // Finds the first value with a key at or after *key and stores its key there
+    // Returns nullptr if there is none
+    T* next(uint64_t* key) {
+        if (root == nullptr || (shift + RADIX_TREE_BITS < 64 && (*key >> (shift + RADIX_TREE_BITS)) != 0))
+            return nullptr;
+
+        return Next(root, shift, *key, key);
+    }
+
+    inline uint64_t count() { return size; }
+
+private:
+    RadixNode* NewNode() {
+        RadixNode* node = spare;
+        if (node != nullptr) {
+            spare = (RadixNode*)node->slots[0];
+            spareCount--;
+        } else
+            node = (RadixNode*)Memory::Heap::Allocate(sizeof(RadixNode));
+
+        memset(node, 0, sizeof(RadixNode));
+        return node;
+    }
+
+    void ReleaseNode(RadixNode* node) {
+        if (spareCount >= RADIX_TREE_MAX_SPARE) {
+            Memory::Heap::Free(node);
+            return;
+        }
+
+        node->slots[0] = spare;
+        spare = node;
+        spareCount++;
+    }
+
+    void FreeNode(RadixNode* node, uint64_t s) {
+        if (s > 0)
+            for (uint64_t i = 0; i < RADIX_TREE_FANOUT; i++)
+                if (node->slots[i] != nullptr)
+                    FreeNode((RadixNode*)node->slots[i], s - RADIX_TREE_BITS);
+
+        Memory::Heap::Free(node);
+    }
+
+    T* Next(RadixNode* node, uint64_t s, uint64_t key, uint64_t* foundKey) {
+        uint64_t start = (key >> s) & (RADIX_TREE_FANOUT - 1);
+        uint64_t remaining = node->present & (~(uint64_t)0 << start);
+
+        while (remaining != 0) {
+            uint64_t index = __builtin_ctzll(remaining);
+            remaining &= remaining - 1;
+
+            // Past the first slot the search starts at the beginning of the child
+            uint64_t high = s + RADIX_TREE_BITS < 64 ? key & (~(uint64_t)0 << (s + RADIX_TREE_BITS)) : 0;
+            uint64_t childKey = index == start ? key : high | (index << s);
+
+            if (s == 0) {
+                *foundKey = childKey;
+                return (T*)node->slots[index];
+            }
+
+            T* value = Next((RadixNode*)node->slots[index], s - RADIX_TREE_BITS, childKey, foundKey);
+            if (value != nullptr)
+                return value;
+        }
+
+        return nullptr;
+    }
+};
\ No newline at end of file
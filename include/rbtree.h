@@ -0,0 +1,300 @@
+#pragma once
+
+#include <stdint.h>
+
+// Embedded in the objects a tree orders, so inserting never allocates
+template <class T> struct RBNode {
+    RBNode* parent;
+    RBNode* left;
+    RBNode* right;
+    bool red;
+
+    T* value;
+};
+
+// Intrusive red-black tree ordered by Less, equal values keep their insertion order
+template <class T, bool (*Less)(T*, T*)> class RBTree {
+    RBNode<T>* root;
+    uint64_t size;
+
+public:
+    constexpr RBTree() : root(nullptr), size(0) {}
+
+    void insert(RBNode<T>* node, T* value) {
+        node->value = value;
+        node->left = nullptr;
+        node->right = nullptr;
+        node->red = true;
+
+        RBNode<T>* parent = nullptr;
+        RBNode<T>** link = &root;
+        while (*link != nullptr) {
+            parent = *link;
+            link = Less(value, parent->value) ? &parent->left : &parent->right;
+        }
+
+        node->parent = parent;
+        *link = node;
+        size++;
+
+        InsertFixup(node);
+    }
+
+    void remove(RBNode<T>* node) {
+        RBNode<T>* child;
+        RBNode<T>* parent;
+        bool red;
+
+        if (node->left == nullptr || node->right == nullptr) {
+            child = node->left != nullptr ? node->left : node->right;
+            parent = node->parent;
+            red = node->red;
+            Replace(node, child);
+        } else {
+            // Swap in the successor
+            RBNode<T>* successor = node->right;
+            while (successor->left != nullptr)
+                successor = successor->left;
+
+            red = successor->red;
+            child = successor->right;
+            if (successor->parent == node)
+                parent = successor;
+            else {
+                parent = successor->parent;
+                parent->left = child;
+                if (child != nullptr)
+                    child->parent = parent;
+
+                successor->right = node->right;
+                node->right->parent = successor;
+            }
+
+            Replace(node, successor);
+            successor->left = node->left;
+            node->left->parent = successor;
+            successor->red = node->red;
+        }
+
+        size--;
+
+        if (!red)
+            RemoveFixup(child, parent);
+    }
+
+    inline RBNode<T>* front() {
+        RBNode<T>* node = root;
+        if (node != nullptr)
+            while (node->left != nullptr)
+                node = node->left;
+
+        return node;
+    }
+
+    inline RBNode<T>* back() {
+        RBNode<T>* node = root;
+        if (node != nullptr)
+            while (node->right != nullptr)
+                node = node->right;
+
+        return node;
+    }
+
+    static RBNode<T>* next(RBNode<T>* node) {
+        if (node->right != nullptr) {
+            node = node->right;
+            while (node->left != nullptr)
+                node = node->left;
+            return node;
+        }
+
+        while (node->parent != nullptr && node == node->parent->right)
+            node = node->parent;
+
+        return node->parent;
+    }
+
+    static RBNode<T>* prev(RBNode<T>* node) {
+        if (node->left != nullptr) {
+            node = node->left;
+            while (node->right != nullptr)
+                node = node->right;
+            return node;
+        }
+
+        while (node->parent != nullptr && node == node->parent->left)
+            node = node->parent;
+
+        return node->parent;
+    }
+
+    // Returns the first node where predicate holds
+    // The predicate must be false for a prefix of the tree and true for the rest
+    template <class P> RBNode<T>* lowerBound(P predicate) {
+        RBNode<T>* result = nullptr;
+        RBNode<T>* node = root;
+        while (node != nullptr) {
+            if (predicate(node->value)) {
+                result = node;
+                node = node->left;
+            } else
+                node = node->right;
+        }
+
+        return result;
+    }
+
+    inline uint64_t count() { return size; }
+
+private:
+    void Replace(RBNode<T>* oldNode, RBNode<T>* newNode) {
+        if (oldNode->parent == nullptr)
+            root = newNode;
+        else if (oldNode == oldNode->parent->left)
+            oldNode->parent->left = newNode;
+        else
+            oldNode->parent->right = newNode;
+
+        if (newNode != nullptr)
+            newNode->parent = oldNode->parent;
+    }
+
+    void RotateLeft(RBNode<T>* node) {
+        RBNode<T>* pivot = node->right;
+        node->right = pivot->left;
+        if (pivot->left != nullptr)
+            pivot->left->parent = node;
+
+        Replace(node, pivot);
+        pivot->left = node;
+        node->parent = pivot;
+    }
+
+    void RotateRight(RBNode<T>* node) {
+        RBNode<T>* pivot = node->left;
+        node->left = pivot->right;
+        if (pivot->right != nullptr)
+            pivot->right->parent = node;
+
+        Replace(node, pivot);
+        pivot->right = node;
+        node->parent = pivot;
+    }
+
+    static inline bool IsRed(RBNode<T>* node) { return node != nullptr && node->red; }
+
+    void InsertFixup(RBNode<T>* node) {
+        while (IsRed(node->parent)) {
+            RBNode<T>* parent = node->parent;
+            RBNode<T>* grandparent = parent->parent;
+
+            if (parent == grandparent->left) {
+                RBNode<T>* uncle = grandparent->right;
+                if (IsRed(uncle)) {
+                    parent->red = false;
+                    uncle->red = false;
+                    grandparent->red = true;
+                    node = grandparent;
+                    continue;
+                }
+
+                if (node == parent->right) {
+                    RotateLeft(parent);
+                    node = parent;
+                    parent = node->parent;
+                }
+
+                parent->red = false;
+                grandparent->red = true;
+                RotateRight(grandparent);
+            } else {
+                RBNode<T>* uncle = grandparent->left;
+                if (IsRed(uncle)) {
+                    parent->red = false;
+                    uncle->red = false;
+                    grandparent->red = true;
+                    node = grandparent;
+                    continue;
+                }
+
+                if (node == parent->left) {
+                    RotateRight(parent);
+                    node = parent;
+                    parent = node->parent;
+                }
+
+                parent->red = false;
+                grandparent->red = true;
+                RotateLeft(grandparent);
+            }
+        }
+
+        root->red = false;
+    }
+
+    // node may be null, so its parent is passed separately
+    void RemoveFixup(RBNode<T>* node, RBNode<T>* parent) {
+        while (node != root && !IsRed(node)) {
+            if (node == parent->left) {
+                RBNode<T>* sibling = parent->right;
+                if (sibling->red) {
+                    sibling->red = false;
+                    parent->red = true;
+                    RotateLeft(parent);
+                    sibling = parent->right;
+                }
+
+                if (!IsRed(sibling->left) && !IsRed(sibling->right)) {
+                    sibling->red = true;
+                    node = parent;
+                    parent = node->parent;
+                    continue;
+                }
+
+                if (!IsRed(sibling->right)) {
+                    sibling->left->red = false;
+                    sibling->red = true;
+                    RotateRight(sibling);
+                    sibling = parent->right;
+                }
+
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->right->red = false;
+                RotateLeft(parent);
+                node = root;
+            } else {
+                RBNode<T>* sibling = parent->left;
+                if (sibling->red) {
+                    sibling->red = false;
+                    parent->red = true;
+                    RotateRight(parent);
+                    sibling = parent->left;
+                }
+
+                if (!IsRed(sibling->left) && !IsRed(sibling->right)) {
+                    sibling->red = true;
+                    node = parent;
+                    parent = node->parent;
+                    continue;
+                }
+
+                if (!IsRed(sibling->left)) {
+                    sibling->right->red = false;
+                    sibling->red = true;
+                    RotateLeft(sibling);
+                    sibling = parent->left;
+                }
+
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->left->red = false;
+                RotateRight(parent);
+                node = root;
+            }
+        }
+
+        if (node != nullptr)
+            node->red = false;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+// Embedded in objects reclaimed through RCU::Call
+struct RCUHead {
+    RCUHead* next;
+    void (*function)(RCUHead* head);
+};
+
+// Read-copy-update, readers traverse without locks while writers defer reclaiming what they unlink
+// Read sections disable preemption, so every pass through the scheduler ends a grace period
+namespace RCU {
+    // Read sections nest and only touch the current process, they must not block
+    void ReadLock();
+    void ReadUnlock();
+
+    // Runs function once every reader that could still reach the object has left
+    // Safe from interrupt handlers, function runs from the scheduler with interrupts disabled and must not block
+    void Call(RCUHead* head, void (*function)(RCUHead* head));
+
+    // Sleeps until every reader that started before the call has left, must not be called inside a read section
+    void Synchronize();
+
+    // Called by the scheduler with interrupts disabled and preemption enabled, runs every queued callback
+    void QuiescentState();
+} // namespace RCU
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+// Bounded lock-free FIFO for exactly one producer and one consumer, such as an IRQ handler and a reader
+// With several producers or consumers, each side must be serialized by the caller
+// Size must be a power of two, the indices only ever increase and are masked on access
+template <class T, uint64_t Size> class RingBuffer {
+    static_assert(Size != 0 && (Size & (Size - 1)) == 0, "RingBuffer size must be a power of two");
+
+    T data[Size];
+    volatile uint64_t head; // Written by the producer
+    volatile uint64_t tail; // Written by the consumer
+
+public:
+    constexpr RingBuffer() : data(), head(0), tail(0) {}
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // Returns false if the buffer is full
+    inline bool push(T value) { return push(&value, 1) == 1; }
+
+    // Returns false if the buffer is empty
+    inline bool pop(T* value) { return pop(value, 1) == 1; }
+
+    // Returns the number of values pushed, which is less than count if the buffer fills
+    uint64_t push(const T* values, uint64_t count) {
+        uint64_t currentHead = head;
+        uint64_t space = Size - (currentHead - tail);
+        if (count > space)
+            count = space;
+
+        for (uint64_t i = 0; i < count; i++)
+            data[(currentHead + i) & (Size - 1)] = values[i];
+
+        // The values must be visible before the consumer can see the new head
+        asm volatile("" : : : "memory");
+        head = currentHead + count;
+        return count;
+    }
+
+    // Returns the number of values popped, which is less than count if the buffer empties
+    uint64_t pop(T* values, uint64_t count) {
+        uint64_t currentTail = tail;
+        uint64_t available = head - currentTail;
+        if (count > available)
+            count = available;
+
+        asm volatile("" : : : "memory");
+        for (uint64_t i = 0; i < count; i++)
+            values[i] = data[(currentTail + i) & (Size - 1)];
+
+        // The values must be read before the producer can reuse their slots
+        asm volatile("" : : : "memory");
+        tail = currentTail + count;
+        return count;
+    }
+
+    inline uint64_t count() { return head - tail; }
+    inline bool empty() { return head == tail; }
+};
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <lockstat.h>
+#include <spinlock.h>
+#include <stdint.h>
+#include <waitqueue.h>
+
+// Sleeping reader-writer lock, new readers wait behind a waiting writer so writers can't starve
+class RWLock {
+public:
+    RWLock(const char* name = nullptr);
+
+    void LockShared();
+    void UnlockShared();
+
+    void Lock();
+    void Unlock();
+
+private:
+    Spinlock lock;
+
+    uint64_t readers;
+    uint64_t waitingWriters;
+    bool writer;
+
+    WaitQueue readerQueue;
+    WaitQueue writerQueue;
+
+#ifdef LOCK_STATS
+    LockStats lockStats;
+#endif
+};
\ No newline at end of file
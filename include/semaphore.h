@@ -1,6 +1,9 @@
 #pragma once
 
+#include <spinlock.h>
 #include <stdint.h>
+#include <time.h>
+#include <waitqueue.h>
 
 class Semaphore {
 public:
@@ -9,7 +12,16 @@ public:
     void Signal();
     void Wait();
 
+    // Returns false instead of sleeping if the value is zero
+    bool TryWait();
+
+    // Returns false if timeout milliseconds pass first
+    bool Wait(time_t timeout);
+
 private:
     uint64_t value;
     uint64_t maxValue;
+
+    Spinlock lock;
+    WaitQueue waiters;
 };
\ No newline at end of file
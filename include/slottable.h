@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector.h>
+
+// Pointers indexed by descriptor number, new entries take the lowest free slot
+// The free slot is found from a two level bitmap instead of scanning the slots
+template <class T> class SlotTable {
+    Vector<T*> slots;
+
+    // A bit per slot set while it is in use
+    Vector<uint64_t> used;
+    // A bit per word of used set while all of its slots are in use
+    Vector<uint64_t> full;
+
+    uint64_t numUsed;
+
+public:
+    constexpr SlotTable() : numUsed(0) {}
+
+    uint64_t insert(T* value) {
+        uint64_t index = FindFree();
+        set(index, value);
+        return index;
+    }
+
+    // Places value at index, growing the table if needed
+    void set(uint64_t index, T* value) {
+        if (value == nullptr) {
+            remove(index);
+            return;
+        }
+
+        while (index >= slots.count())
+            Grow();
+
+        if (slots[index] == nullptr)
+            numUsed++;
+
+        slots[index] = value;
+
+        uint64_t word = index / 64;
+        used[word] |= (uint64_t)1 << (index % 64);
+        if (used[word] == 0xFFFFFFFFFFFFFFFF)
+            full[word / 64] |= (uint64_t)1 << (word % 64);
+    }
+
+    // Returns the removed value
+    T* remove(uint64_t index) {
+        if (index >= slots.count() || slots[index] == nullptr)
+            return nullptr;
+
+        T* value = slots[index];
+        slots[index] = nullptr;
+        numUsed--;
+
+        uint64_t word = index / 64;
+        used[word] &= ~((uint64_t)1 << (index % 64));
+        full[word / 64] &= ~((uint64_t)1 << (word % 64));
+
+        return value;
+    }
+
+    inline T* operator[](uint64_t index) { return index < slots.count() ? slots[index] : nullptr; }
+
+    // Number of slots, including free ones
+    inline uint64_t length() { return slots.count(); }
+
+    // Number of slots in use
+    inline uint64_t count() { return numUsed; }
+
+private:
+    uint64_t FindFree() {
+        for (uint64_t i = 0; i < full.count(); i++) {
+            if (full[i] == 0xFFFFFFFFFFFFFFFF)
+                continue;
+
+            // Bits past the last word of used are clear, so this is only free if the word exists
+            uint64_t word = i * 64 + __builtin_ctzll(~full[i]);
+            if (word >= used.count())
+                break;
+
+            return word * 64 + __builtin_ctzll(~used[word]);
+        }
+
+        return slots.count();
+    }
+
+    void Grow() {
+        uint64_t newLength = slots.count() == 0 ? 64 : slots.count() * 2;
+        slots.resize(newLength, nullptr);
+        used.resize(newLength / 64, 0);
+        full.resize((newLength / 64 + 63) / 64, 0);
+    }
+};
\ No newline at end of file
@@ -1,14 +1,138 @@
 #pragma once
 
+#include <interrupt/irq.h>
+#include <lockstat.h>
+#include <preempt.h>
 #include <stdint.h>
 
+class TicketLock;
+class MCSLock;
+struct MCSNode;
+
+extern "C" void AcquireSpinlock(uint64_t* value);
+extern "C" bool TryAcquireSpinlock(uint64_t* value);
+extern "C" void ReleaseSpinlock(uint64_t* value);
+
+extern "C" void AcquireTicketLock(TicketLock* lock);
+extern "C" void ReleaseTicketLock(TicketLock* lock);
+
+extern "C" void AcquireMCSLock(MCSLock* lock, MCSNode* node);
+extern "C" void ReleaseMCSLock(MCSLock* lock, MCSNode* node);
+
+// Preemption stays disabled while any of these locks is held, so a holder is never switched out while others spin
 class Spinlock {
 public:
-    Spinlock();
+    // Constant initialized so spinlocks in static objects work before global constructors run
+#ifdef LOCK_STATS
+    constexpr Spinlock(const char* name = nullptr) : value(0), lockStats(name) {}
+#else
+    constexpr Spinlock(const char* name = nullptr) : value(0) {}
+#endif
+
+    inline void Acquire() {
+        PreemptDisable();
+#ifdef LOCK_STATS
+        uint64_t start = ReadTSC();
+        bool contended = !TryAcquireSpinlock(&value);
+        if (contended)
+            AcquireSpinlock(&value);
+        lockStats.Acquired(start, contended);
+#else
+        AcquireSpinlock(&value);
+#endif
+    }
+
+    inline void Release() {
+#ifdef LOCK_STATS
+        lockStats.Released();
+#endif
+        ReleaseSpinlock(&value);
+        PreemptEnable();
+    }
+
+    // Disables interrupts on this processor first, so the lock can be shared with interrupt handlers
+    inline uint64_t AcquireIRQ() {
+        uint64_t flags = Interrupt::Disable();
+        Acquire();
+        return flags;
+    }
 
-    void Acquire();
-    void Release();
+    inline void ReleaseIRQ(uint64_t flags) {
+        Release();
+        Interrupt::Restore(flags);
+    }
 
 private:
     uint64_t value;
+
+#ifdef LOCK_STATS
+    LockStats lockStats;
+#endif
+};
+
+// Fair spinlock, waiters are served in the order they arrived
+class TicketLock {
+public:
+    constexpr TicketLock() : next(0), serving(0) {}
+
+    inline void Acquire() {
+        PreemptDisable();
+        AcquireTicketLock(this);
+    }
+
+    inline void Release() {
+        ReleaseTicketLock(this);
+        PreemptEnable();
+    }
+
+    inline uint64_t AcquireIRQ() {
+        uint64_t flags = Interrupt::Disable();
+        Acquire();
+        return flags;
+    }
+
+    inline void ReleaseIRQ(uint64_t flags) {
+        Release();
+        Interrupt::Restore(flags);
+    }
+
+private:
+    volatile uint64_t next;
+    volatile uint64_t serving;
+};
+
+// Supplied by each acquirer, usually on its stack, and passed to the matching Release
+struct MCSNode {
+    MCSNode* volatile next;
+    volatile uint64_t locked;
+};
+
+// Fair queue lock, each waiter spins on its own node instead of the shared lock word
+class MCSLock {
+public:
+    constexpr MCSLock() : tail(nullptr) {}
+
+    inline void Acquire(MCSNode* node) {
+        PreemptDisable();
+        AcquireMCSLock(this, node);
+    }
+
+    inline void Release(MCSNode* node) {
+        ReleaseMCSLock(this, node);
+        PreemptEnable();
+    }
+
+    inline uint64_t AcquireIRQ(MCSNode* node) {
+        uint64_t flags = Interrupt::Disable();
+        Acquire(node);
+        return flags;
+    }
+
+    inline void ReleaseIRQ(MCSNode* node, uint64_t flags) {
+        Release(node);
+        Interrupt::Restore(flags);
+    }
+
+private:
+    MCSNode* volatile tail;
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory/heap.h>
+#include <stdint.h>
+
+// Growable array, elements are moved with Heap::Reallocate so T must be trivially copyable
+template <class T> class Vector {
+    T* data;
+    uint64_t size;
+    uint64_t capacity;
+
+public:
+    constexpr Vector() : data(nullptr), size(0), capacity(0) {}
+    ~Vector() { Memory::Heap::Free(data); }
+
+    Vector(const Vector&) = delete;
+    Vector& operator=(const Vector&) = delete;
+
+    inline void push(T value) {
+        if (size == capacity)
+            reserve(capacity == 0 ? 8 : capacity * 2);
+
+        data[size++] = value;
+    }
+
+    inline void pop() {
+        if (size > 0)
+            size--;
+    }
+
+    // Grows to count elements set to value, or drops the elements past count
+    void resize(uint64_t count, T value) {
+        reserve(count);
+        for (uint64_t i = size; i < count; i++)
+            data[i] = value;
+
+        size = count;
+    }
+
+    void reserve(uint64_t newCapacity) {
+        if (newCapacity <= capacity)
+            return;
+
+        data = (T*)Memory::Heap::Reallocate(data, newCapacity * sizeof(T));
+        capacity = newCapacity;
+    }
+
+    inline void clear() { size = 0; }
+
+    inline T& operator[](uint64_t index) { return data[index]; }
+
+    inline T& back() { return data[size - 1]; }
+
+    inline uint64_t count() { return size; }
+};
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <list.h>
+#include <rbtree.h>
+#include <spinlock.h>
+#include <time.h>
+
+class Process;
+class WaitQueue;
+
+// Per process state for sleeping on a wait queue with a timeout
+struct Waiter {
+    WaitQueue* queue; // Cleared once the process is taken off the queue
+    Spinlock* lock;
+
+    RBNode<Process> timerNode;
+    time_t wakeTime;
+    bool timerQueued;
+    bool timedOut;
+
+    // Tells apart the conditions of processes sharing one queue
+    uint64_t key;
+};
+
+// Processes sleeping on a condition, guarded by a spinlock the caller owns alongside the condition
+class WaitQueue {
+public:
+    constexpr WaitQueue() : waiters() {}
+
+    // Must be called holding lock through AcquireIRQ with the condition still unmet
+    // Releases the lock while asleep and returns with it released and flags restored
+    void Sleep(Spinlock& lock, uint64_t flags);
+
+    // Returns false if timeout milliseconds passed before a wakeup
+    bool Sleep(Spinlock& lock, uint64_t flags, time_t timeout);
+
+    // Sleeps until condition holds or timeout milliseconds pass, zero waits forever, returns false on a timeout
+    // The condition runs holding lock, so it may also consume what it waited for
+    // Whoever makes it true must wake the queue holding the same lock, which interrupt handlers can do
+    template <class C> bool Wait(Spinlock& lock, C condition, time_t timeout = 0) {
+        time_t deadline = timeout == 0 ? 0 : GetCurrentTime() + timeout;
+        while (true) {
+            uint64_t flags = lock.AcquireIRQ();
+            if (condition()) {
+                lock.ReleaseIRQ(flags);
+                return true;
+            }
+
+            if (!Block(lock, flags, deadline))
+                return false;
+        }
+    }
+
+    // These must be called holding the lock, interrupt handlers included
+    // Dequeue removes the first waiter without waking it, so the caller can hand it something first
+    Process* Dequeue();
+    void WakeOne();
+    void WakeAll();
+
+    // Dequeues the first waiter the predicate holds for
+    template <class P> Process* DequeueIf(P predicate) {
+        if (waiters.front() == nullptr)
+            return nullptr;
+
+        List<Process>::Iterator iter(&waiters);
+        do {
+            if (predicate(iter.value)) {
+                Process* process = iter.value;
+                iter.Remove();
+                Detach(process);
+                return process;
+            }
+        } while (iter.Next());
+
+        return nullptr;
+    }
+
+    // Must be called holding the lock
+    template <class F> void ForEach(F function) {
+        if (waiters.front() == nullptr)
+            return;
+
+        List<Process>::Iterator iter(&waiters);
+        do
+            function(iter.value);
+        while (iter.Next());
+    }
+
+    inline bool HasWaiters() { return waiters.front() != nullptr; }
+
+    // Called by the timer interrupt to wake sleepers whose timeout has passed
+    static void ExpireTimers(time_t now);
+
+private:
+    static void Detach(Process* process);
+
+    // Releases lock, returns false without sleeping once the deadline has passed
+    bool Block(Spinlock& lock, uint64_t flags, time_t deadline);
+
+    List<Process> waiters;
+};
\ No newline at end of file
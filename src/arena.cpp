@@ -0,0 +1,52 @@
+#include <arena.h>
+
+#include <memory/heap.h>
+
+Arena::~Arena() {
+    while (current != nullptr) {
+        Block* prev = current->prev;
+        Memory::Heap::Free(current);
+        current = prev;
+    }
+}
+
+void* Arena::Allocate(uint64_t size, uint64_t alignment) {
+    if (current != nullptr) {
+        uint64_t start = (top + alignment - 1) & ~(alignment - 1);
+        if (start + size <= current->size) {
+            top = start + size;
+            return (void*)((uint64_t)current + start);
+        }
+    }
+
+    // The first block is kept for the life of the arena, so it is always the default size
+    // Larger requests get an overflow block chained after it, which Reset frees
+    uint64_t blockSize = ARENA_BLOCK_SIZE;
+    if (first != nullptr && sizeof(Block) + size + alignment > blockSize)
+        blockSize = sizeof(Block) + size + alignment;
+
+    Block* block = (Block*)Memory::Heap::Allocate(blockSize);
+    block->prev = current;
+    block->size = blockSize;
+
+    if (first == nullptr)
+        first = block;
+
+    current = block;
+    top = sizeof(Block);
+
+    return Allocate(size, alignment);
+}
+
+ArenaMark Arena::GetMark() { return ArenaMark{current, top}; }
+
+void Arena::Reset(ArenaMark mark) {
+    // Overflow blocks go back to the heap, the first block is kept
+    while (current != mark.block && current != first) {
+        Block* prev = current->prev;
+        Memory::Heap::Free(current);
+        current = prev;
+    }
+
+    top = mark.block == nullptr ? sizeof(Block) : mark.top;
+}
\ No newline at end of file
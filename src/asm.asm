@@ -14,4 +14,10 @@ CompareExchange:
 GLOBAL Increament
 Increament:
     inc QWORD [rdi]
+    ret
+
+GLOBAL Exchange
+Exchange:
+    mov rax, rsi
+    xchg [rdi], rax
     ret
\ No newline at end of file
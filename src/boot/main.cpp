@@ -14,11 +14,10 @@ extern "C" void kmain() {
     // Initialize the video driver
     InitializeUEFIVideoDriver();
 
-    Queue<Device::Device> consoles;
-    uint64_t count = Device::GetDevices(Device::Device::Type::CONSOLE, consoles);
-    if (count > 0) {
-        Device::Open(consoles.front());
-        Console::SetStdOutput(consoles.front());
+    Device::Device* console;
+    if (Device::GetDevices(Device::Device::Type::CONSOLE, &console, 1) > 0) {
+        Device::Open(console);
+        Console::SetStdOutput(console);
     }
 
     Console::Println("Lance Operating System");
@@ -34,11 +33,10 @@ extern "C" void kmain() {
     InitializeIDEDriver();
     InitializePS2Driver();
 
-    Queue<Device::Device> keyboards;
-    count = Device::GetDevices(Device::Device::Type::KEYBOARD, keyboards);
-    if (count > 0) {
-        Device::Open(keyboards.front());
-        Console::SetStdInput(keyboards.front());
+    Device::Device* keyboard;
+    if (Device::GetDevices(Device::Device::Type::KEYBOARD, &keyboard, 1) > 0) {
+        Device::Open(keyboard);
+        Console::SetStdInput(keyboard);
     }
 
     Console::Println("[ LOS ] Executing shell . . .");
@@ -72,8 +72,19 @@ ACPI_STATUS AcpiOsSignalSemaphore(ACPI_SEMAPHORE Handle, UINT32 Units) {
 
 ACPI_STATUS AcpiOsWaitSemaphore(ACPI_SEMAPHORE Handle, UINT32 Units, UINT16 Timeout) {
     Semaphore* s = (Semaphore*)Handle;
-    for (uint32_t i = 0; i < Units; i++)
-        s->Wait();
+    time_t end = GetCurrentTime() + Timeout;
+    for (uint32_t i = 0; i < Units; i++) {
+        time_t now = GetCurrentTime();
+        if (Timeout == ACPI_WAIT_FOREVER)
+            s->Wait();
+        else if (!s->Wait(now < end ? end - now : 0)) {
+            // Give back the units already taken
+            for (uint32_t j = 0; j < i; j++)
+                s->Signal();
+
+            return AE_TIME;
+        }
+    }
 
     return AE_OK;
 }
@@ -90,15 +101,15 @@ ACPI_STATUS AcpiOsCreateLock(ACPI_SPINLOCK* OutHandle) {
     return AE_OK;
 }
 
+// ACPICA takes these from its interrupt handler too
 ACPI_CPU_FLAGS AcpiOsAcquireLock(ACPI_SPINLOCK Handle) {
     Spinlock* s = (Spinlock*)Handle;
-    s->Acquire();
-    return 0;
+    return s->AcquireIRQ();
 }
 
 void AcpiOsReleaseLock(ACPI_SPINLOCK Handle, ACPI_CPU_FLAGS Flags) {
     Spinlock* s = (Spinlock*)Handle;
-    s->Release();
+    s->ReleaseIRQ(Flags);
 }
 
 void AcpiOsDeleteLock(ACPI_SPINLOCK Handle) {
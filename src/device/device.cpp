@@ -11,13 +11,14 @@ namespace Device {
     }
 
     Device::~Device() {
-        childrenMutex.Lock();
+        refQueue.Wait(refLock, [this] { return refCount.load(MemoryOrder::ACQUIRE) == 0; });
 
-        while (refCount != 0)
-            asm volatile("pause");
+        childrenMutex.Lock();
 
-        for (Device* child = children.front(); child != nullptr; children.pop(), child = children.front())
+        for (Device* child = children.front(); child != nullptr; child = children.front()) {
+            children.pop();
             delete child;
+        }
     }
 
     uint64_t Device::Read(uint64_t address, uint64_t* value) { return ERROR_NOT_IMPLEMENTED; }
@@ -36,42 +37,40 @@ namespace Device {
 
     void Device::AddChild(Device* child) {
         childrenMutex.Lock();
-        children.push(child);
         child->parent = this;
+        children.publish(child, &child->siblingNode);
         childrenMutex.Unlock();
     }
 
-    uint64_t Device::FindDevices(Type type, Queue<Device>& queue) {
-        uint64_t count = 0;
-        childrenMutex.Lock();
+    uint64_t Device::FindDevices(Type type, Device** devices, uint64_t maximum, uint64_t found) {
         if (this->type == type) {
-            queue.push(this);
-            count++;
+            if (found < maximum)
+                devices[found] = this;
+            found++;
         }
 
         if (children.front() != nullptr) {
-            Queue<Device>::Iterator iter(&children);
+            List<Device>::Iterator iter(&children);
             do
-                count += iter.value->FindDevices(type, queue);
+                found = iter.value->FindDevices(type, devices, maximum, found);
             while (iter.Next());
         }
 
-        childrenMutex.Unlock();
-
-        return count;
+        return found;
     }
 
     void Device::RemoveChild(Device* child) {
-        if (children.front() == nullptr)
-            return;
-
-        Queue<Device>::Iterator iter(&children);
-        do {
-            if (iter.value == child) {
-                iter.Remove();
-                break;
-            }
-        } while (iter.Next());
+        childrenMutex.Lock();
+        if (children.front() != nullptr) {
+            List<Device>::Iterator iter(&children);
+            do {
+                if (iter.value == child) {
+                    children.unpublish(&child->siblingNode);
+                    break;
+                }
+            } while (iter.Next());
+        }
+        childrenMutex.Unlock();
     }
 
     const char* Device::GetName() { return name; }
@@ -84,16 +83,33 @@ namespace Device {
     }
 
     void Device::IncreamentRefCount() {
-        if (refCount == (uint64_t)~0)
-            return;
-
-        refCount++;
+        uint64_t count = refCount.load(MemoryOrder::RELAXED);
+        do {
+            if (count == (uint64_t)~0)
+                return;
+        } while (!refCount.compare_exchange(count, count + 1, MemoryOrder::RELAXED));
     }
 
     void Device::DecreamentRefCount() {
-        if (refCount == 0)
+        uint64_t count = refCount.load(MemoryOrder::RELAXED);
+        while (count > 1)
+            if (refCount.compare_exchange(count, count - 1, MemoryOrder::RELEASE))
+                return;
+
+        if (count == 0)
             return;
 
-        refCount--;
+        // The destructor checks the count under the lock, so dropping the last reference under it
+        // keeps the device alive until the wakeup is done and the lock released
+        uint64_t flags = refLock.AcquireIRQ();
+        count = refCount.load(MemoryOrder::RELAXED);
+        do {
+            if (count == 0)
+                break;
+        } while (!refCount.compare_exchange(count, count - 1, MemoryOrder::RELEASE));
+
+        if (count == 1)
+            refQueue.WakeAll();
+        refLock.ReleaseIRQ(flags);
     }
 } // namespace Device
\ No newline at end of file
@@ -15,36 +15,42 @@
 #include <time.h>
 
 void InitializeIDEDriver() {
-    Queue<Device::Device> queue;
-    Device::GetDevices(Device::Device::Type::PCI_DEVICE, queue);
+    // Devices can be registered between the two calls, so only the first count are looked at
+    uint64_t count = Device::GetDevices(Device::Device::Type::PCI_DEVICE, nullptr, 0);
+    if (count == 0)
+        return;
 
-    if (queue.front() != nullptr) {
-        Queue<Device::Device>::Iterator iter(&queue);
-        do {
-            uint64_t devClass, subClass;
-            if (iter.value->Read(PCI_CONFIG_CLASS, &devClass) != SUCCESS) {
-                Console::SetForegroundColor(0xFF, 0x00, 0x00);
-                Console::Println("Failed to read PCI device class!");
-                Console::SetForegroundColor(0xFF, 0xFF, 0xFF);
-                continue;
-            }
+    Device::Device** devices = new Device::Device*[count];
+    uint64_t found = Device::GetDevices(Device::Device::Type::PCI_DEVICE, devices, count);
+    if (found < count)
+        count = found;
+
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t devClass, subClass;
+        if (devices[i]->Read(PCI_CONFIG_CLASS, &devClass) != SUCCESS) {
+            Console::SetForegroundColor(0xFF, 0x00, 0x00);
+            Console::Println("Failed to read PCI device class!");
+            Console::SetForegroundColor(0xFF, 0xFF, 0xFF);
+            continue;
+        }
 
-            if (iter.value->Read(PCI_CONFIG_SUB_CLASS, &subClass) != SUCCESS) {
-                Console::SetForegroundColor(0xFF, 0x00, 0x00);
-                Console::Println("Failed to read PCI device sub class!");
-                Console::SetForegroundColor(0xFF, 0xFF, 0xFF);
-                continue;
-            }
+        if (devices[i]->Read(PCI_CONFIG_SUB_CLASS, &subClass) != SUCCESS) {
+            Console::SetForegroundColor(0xFF, 0x00, 0x00);
+            Console::Println("Failed to read PCI device sub class!");
+            Console::SetForegroundColor(0xFF, 0xFF, 0xFF);
+            continue;
+        }
 
-            if (devClass == 1 && subClass == 1) {
-                IDEDevice* newDevice = new IDEDevice((PCIDevice*)iter.value);
-                Device::UnregisterDevice(iter.value);
-                Device::RegisterDevice(nullptr, newDevice);
-                delete iter.value;
-                return;
-            }
-        } while (iter.Next());
+        if (devClass == 1 && subClass == 1) {
+            IDEDevice* newDevice = new IDEDevice((PCIDevice*)devices[i]);
+            Device::UnregisterDevice(devices[i]);
+            Device::RegisterDevice(nullptr, newDevice);
+            delete devices[i];
+            break;
+        }
     }
+
+    delete[] devices;
 }
 
 IDEDevice::IDEDevice(PCIDevice* pciDevice) : Device("IDE Controller", Type::CONTROLLER), irq(false) {
@@ -245,14 +251,16 @@ uint64_t IDEDevice::Write(uint64_t address, uint64_t value) {
 }
 
 void IDEDevice::WaitIRQ() {
-    while (!irq)
-        ;
-    irq = false;
+    irqQueue.Wait(irqLock, [this] { return irq.exchange(false, MemoryOrder::ACQUIRE); });
 }
 
 void IDEDevice::IRQHandler(void* context) {
     IDEDevice* ide = (IDEDevice*)context;
-    ide->irq = true;
+
+    uint64_t flags = ide->irqLock.AcquireIRQ();
+    ide->irq.store(true, MemoryOrder::RELEASE);
+    ide->irqQueue.WakeAll();
+    ide->irqLock.ReleaseIRQ(flags);
 }
 
 ATAPIDevice::ATAPIDevice(IDEDevice* ide, uint8_t channel, uint8_t drive) : Device("", Type::CD_DRIVE), ide(ide), channel(channel), drive(drive) {
@@ -10,7 +10,7 @@
 
 #include "ps2.h"
 
-PS2Controller::PS2Controller() : Device("PS/2 Controller", Type::CONTROLLER), portExists{false, false}, portIRQ{true, true} {
+PS2Controller::PS2Controller() : Device("PS/2 Controller", Type::CONTROLLER), portExists{false, false}, portIRQ{true, true}, portBuffered{false, false} {
     Interrupt::InstallIRQHandler(1, FirstPortIRQ, this);
     Interrupt::InstallIRQHandler(12, SecondPortIRQ, this);
 
@@ -93,26 +93,25 @@ PS2Controller::PS2Controller() : Device("PS/2 Controller", Type::CONTROLLER), po
         IdentPort(1);
 }
 
-void PS2Controller::FirstPortIRQ(void* context) {
-    PS2Controller* controller = (PS2Controller*)context;
+void PS2Controller::FirstPortIRQ(void* context) { ((PS2Controller*)context)->SignalPort(0); }
+void PS2Controller::SecondPortIRQ(void* context) { ((PS2Controller*)context)->SignalPort(1); }
 
-    if (!controller->portIRQ[0])
-        controller->portData[0] = inb(PS2_REG_DATA);
-    else
-        inb(PS2_REG_DATA);
+void PS2Controller::SignalPort(uint64_t port) {
+    uint64_t flags = portLock.AcquireIRQ();
 
-    controller->portIRQ[0] = true;
-}
-
-void PS2Controller::SecondPortIRQ(void* context) {
-    PS2Controller* controller = (PS2Controller*)context;
+    if (portBuffered[port])
+        portBuffer[port].push(inb(PS2_REG_DATA));
+    else {
+        if (!portIRQ[port].load(MemoryOrder::ACQUIRE))
+            portData[port] = inb(PS2_REG_DATA);
+        else
+            inb(PS2_REG_DATA);
 
-    if (!controller->portIRQ[1])
-        controller->portData[1] = inb(PS2_REG_DATA);
-    else
-        inb(PS2_REG_DATA);
+        portIRQ[port].store(true, MemoryOrder::RELEASE);
+    }
 
-    controller->portIRQ[1] = true;
+    portQueue[port].WakeAll();
+    portLock.ReleaseIRQ(flags);
 }
 
 uint64_t PS2Controller::Write(uint64_t address, uint64_t value) {
@@ -162,7 +161,6 @@ void PS2Controller::IdentPort(uint64_t port) {
 
     uint8_t ident[2];
     int len = -1;
-    uint64_t start;
     if (WriteAndWait(port, PS2_DEV_CMD_IDENTIFY) != SUCCESS) {
         portExists[port] = false;
         return;
@@ -173,26 +171,16 @@ void PS2Controller::IdentPort(uint64_t port) {
         return;
     }
 
-    portIRQ[port] = false;
-    start = GetCurrentTime();
-    while (!portIRQ[port]) {
-        if (GetCurrentTime() > start + PS2_TIMEOUT) {
-            len = 0;
-            break;
-        }
-    }
+    portIRQ[port].store(false, MemoryOrder::RELEASE);
+    if (!portQueue[port].Wait(portLock, [this, port] { return portIRQ[port].load(MemoryOrder::ACQUIRE); }, PS2_TIMEOUT))
+        len = 0;
 
     if (len == -1) {
         ident[0] = portData[port];
-        portIRQ[port] = false;
-        start = GetCurrentTime();
-
-        while (!portIRQ[port]) {
-            if (GetCurrentTime() > start + PS2_TIMEOUT) {
-                len = 1;
-                break;
-            }
-        }
+        portIRQ[port].store(false, MemoryOrder::RELEASE);
+
+        if (!portQueue[port].Wait(portLock, [this, port] { return portIRQ[port].load(MemoryOrder::ACQUIRE); }, PS2_TIMEOUT))
+            len = 1;
 
         if (len == -1) {
             ident[1] = portData[port];
@@ -217,15 +205,13 @@ uint64_t PS2Controller::WriteAndWait(uint64_t port, uint8_t data) {
     if (port > 1)
         return ERROR_BAD_PARAMETER;
 
-    portIRQ[port] = false;
+    portIRQ[port].store(false, MemoryOrder::RELEASE);
     uint64_t status = Write(port, data);
     if (status != SUCCESS)
         return status;
 
-    uint64_t start = GetCurrentTime();
-    while (!portIRQ[port])
-        if (GetCurrentTime() > start + PS2_TIMEOUT)
-            return ERROR_TIMEOUT;
+    if (!portQueue[port].Wait(portLock, [this, port] { return portIRQ[port].load(MemoryOrder::ACQUIRE); }, PS2_TIMEOUT))
+        return ERROR_TIMEOUT;
 
     return SUCCESS;
 }
@@ -240,6 +226,8 @@ PS2Keyboard::PS2Keyboard(PS2Controller* controller, uint64_t port) : Device("PS/
     // Enable scanning
     if (controller->WriteAndWait(port, PS2_DEV_CMD_ENABLE_SCAN) != SUCCESS)
         return;
+
+    controller->portBuffered[port] = true;
 }
 
 int64_t PS2Keyboard::ReadStream(uint64_t address, void* buffer, int64_t count) {
@@ -247,12 +235,11 @@ int64_t PS2Keyboard::ReadStream(uint64_t address, void* buffer, int64_t count) {
     uint8_t* buf = (uint8_t*)buffer;
     int64_t countRead;
     for (countRead = 0; countRead < count; countRead++) {
-        controller->portIRQ[port] = false;
-        while (!controller->portIRQ[port])
-            ;
+        uint8_t scancode;
+        controller->portQueue[port].Wait(controller->portLock, [this, &scancode] { return controller->portBuffer[port].pop(&scancode); });
 
         // Enter key
-        char c = ScancodeToChar(controller->portData[port]);
+        char c = ScancodeToChar(scancode);
         if (c == -1) {
             countRead--;
             continue;
@@ -9,7 +9,7 @@ extern uint8_t font[];
 
 UEFIVideoDevice::UEFIVideoDevice() : Device("UEFI GOP Video", Type::CONSOLE), foregroundColor(0xFFFFFFFF), backgroundColor(0) {
     framebuffer = (uint32_t*)((uint64_t)gopInfo->frameBufferBase + 0xFFFF800000000000);
-    backbuffer = new uint32_t[gopInfo->frameBufferSize];
+    backbuffer = new uint32_t[gopInfo->frameBufferSize / sizeof(uint32_t)];
     framebufferSize = gopInfo->frameBufferSize;
     pixelsPerScanline = gopInfo->pixelsPerScanline;
     width = gopInfo->horizontalResolution;
@@ -175,8 +175,11 @@ void UEFIVideoDevice::ScrollUp() {
 }
 
 void UEFIVideoDevice::ClearScreen() {
-    for (uint64_t i = 0; i < framebufferSize; i++)
+    // framebufferSize is in bytes
+    for (uint64_t i = 0; i < framebufferSize / sizeof(uint32_t); i++) {
         framebuffer[i] = backgroundColor;
+        backbuffer[i] = backgroundColor;
+    }
 
     cursorX = 0;
     cursorY = 1;
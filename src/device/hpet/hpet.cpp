@@ -1,17 +1,27 @@
 #include <time.h>
 
+#include <atomic.h>
 #include <console.h>
 #include <device/acpi/acpi.h>
 #include <interrupt/irq.h>
 #include <memory/virtual.h>
 #include <panic.h>
+#include <waitqueue.h>
 
 #include "hpet.h"
 
 uint64_t* address;
-uint64_t currentTimeMillis;
+Atomic<uint64_t> currentTimeMillis;
 
-void TimerIRQHandler(void* context) { currentTimeMillis++; }
+// Nothing wakes this queue, sleepers only leave it when their timeout expires
+Spinlock sleepLock("sleep");
+WaitQueue sleepQueue;
+
+void TimerIRQHandler(void* context) {
+    // The clock doesn't publish anything else, so no ordering is needed
+    time_t now = currentTimeMillis.fetch_add(1, MemoryOrder::RELAXED) + 1;
+    WaitQueue::ExpireTimers(now);
+}
 
 extern "C" void InitSystemTimer() {
     // Get the HPET table
@@ -57,12 +67,11 @@ extern "C" void InitSystemTimer() {
     address[HPET_TIMER_COMPARE_REG(0)] = timerVal;
 }
 
-time_t GetCurrentTime() { return currentTimeMillis; }
+time_t GetCurrentTime() { return currentTimeMillis.load(MemoryOrder::RELAXED); }
 
 void Sleep(time_t milliseconds) {
-    // Blocking sleep function
-    uint64_t startTime = currentTimeMillis;
-    uint64_t endTime = startTime + milliseconds;
-    while (currentTimeMillis < endTime)
-        ;
+    if (milliseconds == 0)
+        return;
+
+    sleepQueue.Wait(sleepLock, [] { return false; }, milliseconds);
 }
\ No newline at end of file
@@ -1,16 +1,21 @@
 #include <device/manager.h>
 
 #include <errno.h>
+#include <rcu.h>
 
 namespace Device {
-    Queue<Device> rootDevices;
+    // Read under RCU, the mutex only serializes writers
+    List<Device> rootDevices;
+    Mutex rootDevicesMutex("root devices");
 
     uint64_t RegisterDevice(Device* parent, Device* newDevice) {
         if (newDevice == nullptr)
             return ERROR_BAD_PARAMETER;
 
         if (parent == nullptr) {
-            rootDevices.push(newDevice);
+            rootDevicesMutex.Lock();
+            rootDevices.publish(newDevice, &newDevice->siblingNode);
+            rootDevicesMutex.Unlock();
             return SUCCESS;
         }
 
@@ -21,28 +26,34 @@ namespace Device {
 
     void UnregisterDevice(Device* device) {
         if (device->GetParent() == nullptr) {
-            if (rootDevices.front() == nullptr)
-                return;
-
-            Queue<Device>::Iterator iter(&rootDevices);
-            do {
-                if (iter.value == device) {
-                    iter.Remove();
-                    break;
-                }
-            } while (iter.Next());
+            rootDevicesMutex.Lock();
+            if (rootDevices.front() != nullptr) {
+                List<Device>::Iterator iter(&rootDevices);
+                do {
+                    if (iter.value == device) {
+                        rootDevices.unpublish(&device->siblingNode);
+                        break;
+                    }
+                } while (iter.Next());
+            }
+            rootDevicesMutex.Unlock();
         } else
             device->GetParent()->RemoveChild(device);
+
+        // Wait out any walk that could still be on the device, so the caller can delete it
+        RCU::Synchronize();
     }
 
-    uint64_t GetDevices(Device::Type type, Queue<Device>& queue) {
+    uint64_t GetDevices(Device::Type type, Device** devices, uint64_t maximum) {
         uint64_t count = 0;
+        RCU::ReadLock();
         if (rootDevices.front() != nullptr) {
-            Queue<Device>::Iterator iter(&rootDevices);
+            List<Device>::Iterator iter(&rootDevices);
             do
-                count += iter.value->FindDevices(type, queue);
+                count = iter.value->FindDevices(type, devices, maximum, count);
             while (iter.Next());
         }
+        RCU::ReadUnlock();
 
         return count;
     }
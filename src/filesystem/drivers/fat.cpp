@@ -2,12 +2,16 @@
 
 #include "fat.h"
 
+#include <arena.h>
 #include <console.h>
 #include <errno.h>
 #include <string.h>
 
 FATDriver fatDriver;
 
+ObjectCache<FATDirectory> fatDirectoryCache;
+ObjectCache<FATFile> fatFileCache;
+
 void InitializeFAT() { RegisterFilesystemDriver(&fatDriver); }
 
 int64_t FATDriver::DetectFilesystem(Device::Device* drive, uint64_t startLBA, int64_t _size) {
@@ -206,7 +210,7 @@ Queue<void>* FATDriver::GetClusterChain(uint32_t firstCluster, FATFilesystem* fi
         uint32_t FATOffset = ((cluster * 4) % filesystem->bytesPerSector) / 4;
 
         if (lastFATSector != FATSector) {
-            if (filesystem->Read(FATSector, buffer, filesystem->bytesPerSector) < 0) {
+            if (filesystem->ReadFATSector(FATSector, buffer) < 0) {
                 delete buffer;
                 return nullptr;
             }
@@ -235,12 +239,12 @@ bool FATDriver::ShrinkClusterChain(uint32_t firstCluster, uint32_t newClusterCou
         uint32_t FATOffset = ((cluster * 4) % filesystem->bytesPerSector) / 4;
 
         if (lastFATSector != FATSector) {
-            if (lastFATSector != 0xFFFFFFFF && filesystem->Write(lastFATSector, buffer, filesystem->bytesPerSector) < 0) {
+            if (lastFATSector != 0xFFFFFFFF && filesystem->WriteFATSector(lastFATSector, buffer) < 0) {
                 delete buffer;
                 return false;
             }
 
-            if (filesystem->Read(FATSector, buffer, filesystem->bytesPerSector) < 0) {
+            if (filesystem->ReadFATSector(FATSector, buffer) < 0) {
                 delete buffer;
                 return false;
             }
@@ -257,7 +261,7 @@ bool FATDriver::ShrinkClusterChain(uint32_t firstCluster, uint32_t newClusterCou
         index++;
     } while (cluster != 0 && !((cluster & 0x0FFFFFFF) >= 0x0FFFFFF8));
 
-    if (filesystem->Write(lastFATSector, buffer, filesystem->bytesPerSector) < 0) {
+    if (filesystem->WriteFATSector(lastFATSector, buffer) < 0) {
         delete buffer;
         return false;
     }
@@ -284,8 +288,11 @@ int64_t FATDriver::Read(File* file, int64_t offset, void* buffer, int64_t count)
         return -1;
     }
 
-    uint8_t* bufferToUse = new uint8_t[numClusters * fs->bytesPerSector * fs->sectorsPerCluster];
+    ArenaScope scope(&currentProcess->arena);
+
+    uint8_t* bufferToUse = scope.Allocate<uint8_t>(numClusters * fs->bytesPerSector * fs->sectorsPerCluster);
     uint64_t bufferOffset = 0;
+    bool failed = false;
     while (clusterChain->front()) {
         uint32_t cluster = (uint64_t)clusterChain->front();
         clusterChain->pop();
@@ -296,8 +303,10 @@ int64_t FATDriver::Read(File* file, int64_t offset, void* buffer, int64_t count)
             continue;
         }
 
-        if (fs->Read(fs->ClusterToLBA(cluster), bufferToUse + bufferOffset, fs->bytesPerSector * fs->sectorsPerCluster) < 0)
-            return -1;
+        if (fs->Read(fs->ClusterToLBA(cluster), bufferToUse + bufferOffset, fs->bytesPerSector * fs->sectorsPerCluster) < 0) {
+            failed = true;
+            break;
+        }
 
         bufferOffset += fs->bytesPerSector * fs->sectorsPerCluster;
 
@@ -306,6 +315,13 @@ int64_t FATDriver::Read(File* file, int64_t offset, void* buffer, int64_t count)
             break;
     }
 
+    while (clusterChain->front())
+        clusterChain->pop();
+    delete clusterChain;
+
+    if (failed)
+        return -1;
+
     memcpy(buffer, bufferToUse + (offset % (fs->bytesPerSector * fs->sectorsPerCluster)), count);
 
     return count;
@@ -371,7 +387,7 @@ int64_t FATDriver::Truncate(File* file, int64_t newSize) {
         uint32_t FATOffset = ((cluster * 4) % fs->bytesPerSector) / 4;
 
         if (lastFATSector != FATSector) {
-            if (fs->Read(FATSector, buffer, fs->bytesPerSector) < 0) {
+            if (fs->ReadFATSector(FATSector, buffer) < 0) {
                 delete buffer;
                 delete dirBuffer;
                 return -1;
@@ -398,9 +414,51 @@ int64_t FATDriver::Truncate(File* file, int64_t newSize) {
     return 0;
 }
 
-FATFilesystem::FATFilesystem(Device::Device* drive, FilesystemDriver* driver, uint64_t startLBA, int64_t length, const char* name) : Filesystem(drive, driver, startLBA, length, name) {}
+FATFilesystem::FATFilesystem(Device::Device* drive, FilesystemDriver* driver, uint64_t startLBA, int64_t length, const char* name) : Filesystem(drive, driver, startLBA, length, name), fatCacheMutex("FAT cache") {}
 uint64_t FATFilesystem::ClusterToLBA(uint32_t cluster) { return firstUsableCluster + cluster * sectorsPerCluster - 2 * sectorsPerCluster; }
 
+int64_t FATFilesystem::ReadFATSector(uint32_t sector, void* buffer) {
+    fatCacheMutex.Lock();
+    uint8_t* cached = fatCache.find(sector - firstFATSector);
+    if (cached != nullptr) {
+        memcpy(buffer, cached, bytesPerSector);
+        fatCacheMutex.Unlock();
+        return bytesPerSector;
+    }
+
+    int64_t ret = Read(sector, buffer, bytesPerSector);
+    if (ret >= 0 && fatCache.count() < FAT_CACHE_MAXIMUM_SECTORS) {
+        cached = new uint8_t[bytesPerSector];
+        memcpy(cached, buffer, bytesPerSector);
+        fatCache.insert(sector - firstFATSector, cached);
+    }
+    fatCacheMutex.Unlock();
+
+    return ret;
+}
+
+int64_t FATFilesystem::WriteFATSector(uint32_t sector, void* buffer) {
+    fatCacheMutex.Lock();
+    int64_t ret = Write(sector, buffer, bytesPerSector);
+    if (ret >= 0) {
+        uint8_t* cached = fatCache.find(sector - firstFATSector);
+        if (cached != nullptr)
+            memcpy(cached, buffer, bytesPerSector);
+    } else {
+        // The sector may be half written, so the next read goes to the disk
+        delete[] fatCache.remove(sector - firstFATSector);
+    }
+    fatCacheMutex.Unlock();
+
+    return ret;
+}
+
 FATDirectory::FATDirectory(const char* name, Directory* parent, Filesystem* filesystem, uint32_t firstCluster) : Directory(name, parent, filesystem), firstCluster(firstCluster) {}
 
+void* FATDirectory::operator new(size_t size) { return fatDirectoryCache.Allocate(size); }
+void FATDirectory::operator delete(void* ptr) { fatDirectoryCache.Free(ptr); }
+
 FATFile::FATFile(const char* name, int64_t size, Directory* directory, Filesystem* filesystem, uint32_t firstCluster, int flags) : File(name, size, directory, filesystem, flags), firstCluster(firstCluster) {}
+
+void* FATFile::operator new(size_t size) { return fatFileCache.Allocate(size); }
+void FATFile::operator delete(void* ptr) { fatFileCache.Free(ptr); }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <filesystem/driver.h>
+#include <mutex.h>
+#include <radixtree.h>
 
 #define BOOT_RECORD_SECTOR 0
 
@@ -19,6 +21,8 @@
 
 #define BPB_BOOTCODE 510
 
+#define FAT_CACHE_MAXIMUM_SECTORS 256
+
 #define FSINFO_SIGNATURE_1 0x0
 #define FSINFO_SIGNATURE_2 0x1E4
 
@@ -107,6 +111,14 @@ public:
 private:
     uint64_t ClusterToLBA(uint32_t cluster);
 
+    // Every cluster chain walk goes through the FAT, so its sectors are kept once read, up to FAT_CACHE_MAXIMUM_SECTORS
+    int64_t ReadFATSector(uint32_t sector, void* buffer);
+    int64_t WriteFATSector(uint32_t sector, void* buffer);
+
+    // Keyed by sector within the FAT
+    Mutex fatCacheMutex;
+    RadixTree<uint8_t> fatCache;
+
     uint16_t bytesPerSector;
     uint8_t sectorsPerCluster;
     uint32_t firstFATSector;
@@ -119,6 +131,9 @@ class FATDirectory : public Directory {
 public:
     FATDirectory(const char* name, Directory* parent, Filesystem* filesystem, uint32_t firstCluster);
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
 private:
     uint32_t firstCluster;
 };
@@ -129,6 +144,9 @@ class FATFile : public File {
 public:
     FATFile(const char* name, int64_t size, Directory* directory, Filesystem* filesystem, uint32_t firstCluster, int flags);
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
 private:
     uint32_t firstCluster;
 };
\ No newline at end of file
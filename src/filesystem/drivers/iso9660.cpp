@@ -2,6 +2,7 @@
 
 #include "iso9660.h"
 
+#include <arena.h>
 #include <console.h>
 #include <errno.h>
 #include <string.h>
@@ -169,8 +170,10 @@ int64_t ISO9660Driver::Read(File* file, int64_t offset, void* buffer, int64_t co
         readEnd += 2048;
     }
 
+    ArenaScope scope(&currentProcess->arena);
+
     int64_t bufToUseSize = readEnd - readStart;
-    uint8_t* bufToUse = new uint8_t[bufToUseSize];
+    uint8_t* bufToUse = scope.Allocate<uint8_t>(bufToUseSize);
 
     int64_t ret = file->GetFilesystem()->Read(isoFile->entryLBA + (readStart / 2048), bufToUse, bufToUseSize);
     if (ret < 0)
@@ -178,8 +181,6 @@ int64_t ISO9660Driver::Read(File* file, int64_t offset, void* buffer, int64_t co
 
     memcpy(buffer, (void*)((uint64_t)bufToUse + (offset & 2047)), count);
 
-    delete bufToUse;
-
     return count;
 }
 
@@ -3,32 +3,40 @@
 
 #include <console.h>
 #include <errno.h>
+#include <rwlock.h>
+#include <slottable.h>
 #include <string.h>
 
-Mutex filesystemsMutex;
-Filesystem** filesystems = nullptr;
-uint64_t filesystemsSize = 0;
+// Guards the table, the directory trees hanging off it are read only once registered
+RWLock filesystemsLock("filesystems");
+SlotTable<Filesystem> filesystems;
 
 Queue<FilesystemDriver> filesystemDrivers;
-Mutex filesystemDriversMutex;
+Mutex filesystemDriversMutex("filesystem drivers");
+
+ObjectCache<Directory> directoryCache;
+ObjectCache<FileDescriptor> fileDescriptorCache;
 
 File::File(const char* name, int64_t size, Directory* directory, Filesystem* filesystem, uint64_t flags) : size(size), directory(directory), filesystem(filesystem), refCount(0), flags(flags) {
     this->name = new char[strlen(name) + 1];
     strcpy(this->name, name);
 }
 
+// Files are opened and closed by every process, so the count saturates without a lock
 void File::IncreamentRefCount() {
-    if (refCount == (uint64_t)~0)
-        return;
-
-    refCount++;
+    uint64_t count = refCount.load(MemoryOrder::RELAXED);
+    do {
+        if (count == (uint64_t)~0)
+            return;
+    } while (!refCount.compare_exchange(count, count + 1, MemoryOrder::RELAXED));
 }
 
 void File::DecreamentRefCount() {
-    if (refCount == 0)
-        return;
-
-    refCount--;
+    uint64_t count = refCount.load(MemoryOrder::RELAXED);
+    do {
+        if (count == 0)
+            return;
+    } while (!refCount.compare_exchange(count, count - 1, MemoryOrder::RELEASE));
 }
 
 void File::SetSize(int64_t newSize) { size = newSize; }
@@ -39,6 +47,9 @@ const char* File::GetName() { return name; }
 uint64_t File::GetFlags() { return flags; }
 Directory* File::GetDirectory() { return directory; }
 
+void* Directory::operator new(size_t size) { return directoryCache.Allocate(size); }
+void Directory::operator delete(void* ptr) { directoryCache.Free(ptr); }
+
 Directory::Directory(const char* name, Directory* parent, Filesystem* filesystem) : filesystem(filesystem) {
     this->name = new char[strlen(name) + 1];
     strcpy(this->name, name);
@@ -49,12 +60,29 @@ Directory::Directory(const char* name, Directory* parent, Filesystem* filesystem
         this->parent = parent;
 }
 
-void Directory::AddSubDirectory(Directory* directory) { subDirectories.push(directory); }
-void Directory::AddSubFile(File* file) { files.push(file); }
+void Directory::AddSubDirectory(Directory* directory) {
+    subDirectories.publish(directory, &directory->siblingNode);
+    subDirectoryNames.insert({directory->name, strlen(directory->name)}, directory);
+}
+
+void Directory::AddSubFile(File* file) {
+    files.publish(file, &file->directoryNode);
+    fileNames.insert({file->name, strlen(file->name)}, file);
+}
 
 const char* Directory::GetName() { return name; }
-Queue<Directory>* Directory::GetSubDirectories() { return &subDirectories; }
-Queue<File>* Directory::GetFiles() { return &files; }
+List<Directory>* Directory::GetSubDirectories() { return &subDirectories; }
+List<File>* Directory::GetFiles() { return &files; }
+
+Directory* Directory::FindSubDirectory(const char* name, uint64_t length) {
+    Directory** directory = subDirectoryNames.find({name, length});
+    return directory != nullptr ? *directory : nullptr;
+}
+
+File* Directory::FindFile(const char* name, uint64_t length) {
+    File** file = fileNames.find({name, length});
+    return file != nullptr ? *file : nullptr;
+}
 
 char* Directory::GetFullName() {
     if (parent == this) {
@@ -101,7 +129,7 @@ uint64_t Directory::GetEntries(Dirent* entries, uint64_t size) {
 
     int i = 2;
     if (subDirectories.front() != nullptr) {
-        Queue<Directory>::Iterator iter(&subDirectories);
+        List<Directory>::Iterator iter(&subDirectories);
         do {
             entries[i].type = DIRENT_TYPE_DIRECTORY;
             strcpy(entries[i].name, iter.value->GetName());
@@ -110,7 +138,7 @@ uint64_t Directory::GetEntries(Dirent* entries, uint64_t size) {
     }
 
     if (files.front() != nullptr) {
-        Queue<File>::Iterator iter(&files);
+        List<File>::Iterator iter(&files);
         do {
             entries[i].type = DIRENT_TYPE_FILE;
             entries[i].size = iter.value->GetSize();
@@ -151,43 +179,16 @@ void Filesystem::SetNumber(int number) { filesystemNumber = number; }
 int Filesystem::GetNumber() { return filesystemNumber; }
 
 void RegisterFilesystem(Filesystem* filesystem) {
-    filesystemsMutex.Lock();
-    for (uint64_t i = 0; i < filesystemsSize; i++) {
-        if (filesystems[i] == nullptr) {
-            filesystems[i] = filesystem;
-            filesystemsMutex.Unlock();
-            return;
-        }
-    }
-
-    // No filesystems available
-    // Resize the filesystem array
-    uint64_t newFilesystemIndex = filesystemsSize;
-    filesystemsSize = filesystemsSize << 1;
-
-    if (filesystemsSize == 0)
-        filesystemsSize = 8;
-
-    Filesystem** newArray = new Filesystem*[filesystemsSize];
-    for (uint64_t i = 0; i < newFilesystemIndex; i++)
-        newArray[i] = filesystems[i];
-
-    for (uint64_t i = newFilesystemIndex; i < filesystemsSize; i++)
-        newArray[i] = nullptr;
-
-    newArray[newFilesystemIndex] = filesystem;
-    filesystem->SetNumber(newFilesystemIndex);
-
-    if (filesystems != nullptr)
-        delete filesystems;
-
-    filesystems = newArray;
-
-    filesystemsMutex.Unlock();
+    filesystemsLock.Lock();
+    filesystem->SetNumber(filesystems.insert(filesystem));
+    filesystemsLock.Unlock();
 }
 
 FileDescriptor::FileDescriptor(File* file, int flags) : file(file), offset(0), flags(flags) {}
 
+void* FileDescriptor::operator new(size_t size) { return fileDescriptorCache.Allocate(size); }
+void FileDescriptor::operator delete(void* ptr) { fileDescriptorCache.Free(ptr); }
+
 void RegisterDrive(Device::Device* drive, int64_t driveSize) {
     if (driveSize < 0)
         return;
@@ -222,7 +223,7 @@ int Open(const char* filepath, int flags) {
     const char* ptr = filepath;
     Directory* currentDirectory;
 
-    filesystemsMutex.Lock();
+    // The root directory is looked up under the filesystems lock, which may sleep, so before the read section
     if (*ptr == ':') {
         // Absolute filepath
         // Find the drive
@@ -231,7 +232,6 @@ int Open(const char* filepath, int flags) {
         while (*ptr != '/' && *ptr != '\\') {
             if (*ptr < '0' || *ptr > '9') {
                 errno = ERROR_BAD_PARAMETER;
-                filesystemsMutex.Unlock();
                 return -1;
             }
 
@@ -240,25 +240,17 @@ int Open(const char* filepath, int flags) {
             ptr++;
         }
 
-        if (driveNumber > filesystemsSize) {
-            errno = ERROR_BAD_PARAMETER;
-            filesystemsMutex.Unlock();
-            return -1;
-        }
-
-        if (!filesystems || filesystems[driveNumber] == nullptr) {
+        if (driveNumber >= (uint64_t)GetNumFilesystems()) {
             errno = ERROR_BAD_PARAMETER;
-            filesystemsMutex.Unlock();
             return -1;
         }
 
-        currentDirectory = filesystems[driveNumber]->GetRootDirectory();
+        currentDirectory = GetRootDirectory(driveNumber);
 
         ptr++;
     } else {
         if (currentProcess->currentDirectory == nullptr) {
             errno = ERROR_BAD_PARAMETER;
-            filesystemsMutex.Unlock();
             return -1;
         }
 
@@ -267,10 +259,10 @@ int Open(const char* filepath, int flags) {
 
     if (currentDirectory == nullptr) {
         errno = ERROR_BAD_PARAMETER;
-        filesystemDriversMutex.Unlock();
         return -1;
     }
 
+    // Directories are complete before their filesystem is registered and never change or get freed, so the walk takes no locks
     const char* start;
     while (1) {
         start = ptr;
@@ -282,7 +274,6 @@ int Open(const char* filepath, int flags) {
 
         if (start == ptr) {
             errno = ERROR_BAD_PARAMETER;
-            filesystemsMutex.Unlock();
             return -1;
         }
 
@@ -299,29 +290,9 @@ int Open(const char* filepath, int flags) {
             }
         }
 
-        Queue<Directory>* directories = currentDirectory->GetSubDirectories();
-        if (directories->front() == nullptr) {
+        currentDirectory = currentDirectory->FindSubDirectory(start, ptr - start);
+        if (currentDirectory == nullptr) {
             errno = ERROR_BAD_PARAMETER;
-            filesystemsMutex.Unlock();
-            return -1;
-        }
-
-        Queue<Directory>::Iterator iter(directories);
-        bool found = false;
-        do {
-            if (strlen(iter.value->GetName()) != (uint64_t)(ptr - start))
-                continue;
-
-            if (memcmp(iter.value->GetName(), start, ptr - start))
-                continue;
-
-            found = true;
-            currentDirectory = iter.value;
-        } while (iter.Next());
-
-        if (!found) {
-            errno = ERROR_BAD_PARAMETER;
-            filesystemsMutex.Unlock();
             return -1;
         }
 
@@ -329,31 +300,11 @@ int Open(const char* filepath, int flags) {
     }
 
     if (start == ptr) {
-        errno = ERROR_BAD_PARAMETER;
-        filesystemsMutex.Unlock();
-        return -1;
-    }
-
-    Queue<File>* files = currentDirectory->GetFiles();
-    if (files->front() == nullptr) {
         errno = ERROR_BAD_PARAMETER;
         return -1;
     }
 
-    Queue<File>::Iterator iter(files);
-    File* file = nullptr;
-    do {
-        if (strlen(iter.value->GetName()) != (uint64_t)(ptr - start))
-            continue;
-
-        if (memcmp(iter.value->GetName(), start, ptr - start))
-            continue;
-
-        file = iter.value;
-        break;
-    } while (iter.Next());
-
-    filesystemsMutex.Unlock();
+    File* file = currentDirectory->FindFile(start, ptr - start);
 
     if (file == nullptr) {
         errno = ERROR_BAD_PARAMETER;
@@ -365,7 +316,7 @@ int Open(const char* filepath, int flags) {
 }
 
 void Close(int fd) {
-    if (fd >= (int)currentProcess->filesLength) {
+    if (fd >= (int)currentProcess->files.length()) {
         errno = ERROR_BAD_PARAMETER;
         return;
     }
@@ -376,12 +327,11 @@ void Close(int fd) {
     }
 
     currentProcess->files[fd]->file->DecreamentRefCount();
-    delete currentProcess->files[fd];
-    currentProcess->files[fd] = nullptr;
+    delete currentProcess->files.remove(fd);
 }
 
 int64_t Read(int fd, void* buffer, int64_t count) {
-    if (fd >= (int)currentProcess->filesLength) {
+    if (fd >= (int)currentProcess->files.length()) {
         errno = ERROR_BAD_PARAMETER;
         return -1;
     }
@@ -411,7 +361,7 @@ int64_t Read(int fd, void* buffer, int64_t count) {
 }
 
 int64_t Write(int fd, void* buffer, int64_t count) {
-    if (fd >= (int)currentProcess->filesLength) {
+    if (fd >= (int)currentProcess->files.length()) {
         errno = ERROR_BAD_PARAMETER;
         return -1;
     }
@@ -430,7 +380,7 @@ int64_t Write(int fd, void* buffer, int64_t count) {
 }
 
 int64_t Seek(int fd, int64_t offset, int whence) {
-    if (fd >= (int)currentProcess->filesLength) {
+    if (fd >= (int)currentProcess->files.length()) {
         errno = ERROR_BAD_PARAMETER;
         return -1;
     }
@@ -451,7 +401,7 @@ int64_t Seek(int fd, int64_t offset, int whence) {
 }
 
 int64_t Tell(int fd) {
-    if (fd >= (int)currentProcess->filesLength) {
+    if (fd >= (int)currentProcess->files.length()) {
         errno = ERROR_BAD_PARAMETER;
         return -1;
     }
@@ -465,7 +415,7 @@ int64_t Tell(int fd) {
 }
 
 int64_t Truncate(int fd, int64_t newSize) {
-    if (fd >= (int)currentProcess->filesLength) {
+    if (fd >= (int)currentProcess->files.length()) {
         errno = ERROR_BAD_PARAMETER;
         return -1;
     }
@@ -483,14 +433,14 @@ int64_t Truncate(int fd, int64_t newSize) {
     return currentProcess->files[fd]->file->GetFilesystem()->GetDriver()->Truncate(currentProcess->files[fd]->file, newSize);
 }
 
-int GetNumFilesystems() { return filesystemsSize; }
+int GetNumFilesystems() { return filesystems.length(); }
 
 Directory* GetRootDirectory(int filesystem) {
     Directory* ret = nullptr;
-    filesystemDriversMutex.Lock();
-    if (filesystem < (int)filesystemsSize && filesystems[filesystem] != nullptr)
+    filesystemsLock.LockShared();
+    if (filesystem >= 0 && filesystems[filesystem] != nullptr)
         ret = filesystems[filesystem]->GetRootDirectory();
-    filesystemDriversMutex.Unlock();
+    filesystemsLock.UnlockShared();
 
     return ret;
 }
@@ -500,51 +450,42 @@ uint64_t ChangeDirectory(const char* path) {
     const char* ptr = path;
     Directory* currentDirectory;
 
-    filesystemsMutex.Lock();
+    // The root directory is looked up under the filesystems lock, which may sleep, so before the read section
     if (*ptr == ':') {
         // Absolute filepath
         // Find the drive
         uint64_t driveNumber = 0;
         ptr++;
         while (*ptr != '/' && *ptr != '\\' && *ptr != 0) {
-            if (*ptr < '0' || *ptr > '9') {
-                filesystemsMutex.Unlock();
+            if (*ptr < '0' || *ptr > '9')
                 return 1;
-            }
 
             driveNumber *= 10;
             driveNumber += *ptr - '0';
             ptr++;
         }
 
-        if (driveNumber > filesystemsSize) {
-            filesystemsMutex.Unlock();
+        if (driveNumber >= (uint64_t)GetNumFilesystems())
             return 1;
-        }
 
-        if (filesystems[driveNumber] == nullptr) {
-            filesystemsMutex.Unlock();
+        currentDirectory = GetRootDirectory(driveNumber);
+        if (currentDirectory == nullptr)
             return 1;
-        }
-
-        currentDirectory = filesystems[driveNumber]->GetRootDirectory();
 
         if (*ptr == 0) {
             currentProcess->currentDirectory = currentDirectory;
-            filesystemsMutex.Unlock();
             return 0;
         }
 
         ptr++;
     } else {
-        if (currentProcess->currentDirectory == nullptr) {
-            filesystemsMutex.Unlock();
+        if (currentProcess->currentDirectory == nullptr)
             return 1;
-        }
 
         currentDirectory = currentProcess->currentDirectory;
     }
 
+    // Directories are complete before their filesystem is registered and never change or get freed, so the walk takes no locks
     const char* start;
     while (1) {
         start = ptr;
@@ -554,7 +495,6 @@ uint64_t ChangeDirectory(const char* path) {
         if (start == ptr) {
             if (*ptr == 0)
                 break;
-            filesystemsMutex.Unlock();
             return 1;
         }
 
@@ -575,29 +515,9 @@ uint64_t ChangeDirectory(const char* path) {
             }
         }
 
-        Queue<Directory>* directories = currentDirectory->GetSubDirectories();
-        if (directories->front() == nullptr) {
-            filesystemsMutex.Unlock();
-            return 1;
-        }
-
-        Queue<Directory>::Iterator iter(directories);
-        bool found = false;
-        do {
-            if (strlen(iter.value->GetName()) != (uint64_t)(ptr - start))
-                continue;
-
-            if (memcmp(iter.value->GetName(), start, ptr - start))
-                continue;
-
-            found = true;
-            currentDirectory = iter.value;
-        } while (iter.Next());
-
-        if (!found) {
-            filesystemsMutex.Unlock();
+        currentDirectory = currentDirectory->FindSubDirectory(start, ptr - start);
+        if (currentDirectory == nullptr)
             return 1;
-        }
 
         if (*ptr == 0)
             break;
@@ -607,7 +527,5 @@ uint64_t ChangeDirectory(const char* path) {
 
     currentProcess->currentDirectory = currentDirectory;
 
-    filesystemsMutex.Unlock();
-
     return 0;
 }
\ No newline at end of file
@@ -17,11 +17,11 @@
 
 namespace Interrupt {
     ExceptionHandler exceptionHandlers[NUM_EXCEPTIONS];
-    Mutex exceptionHandlersMutex;
+    Mutex exceptionHandlersMutex("exception handlers");
 
     IRQHandler irqHandlers[NUM_IRQ];
     void* irqContexts[NUM_IRQ];
-    Mutex irqHandlersMutex;
+    Mutex irqHandlersMutex("IRQ handlers");
 
     IDTDescr idt[256];
     CPUPointer idtr;
@@ -0,0 +1,142 @@
+#include <lockstat.h>
+
+#include <console.h>
+#include <errno.h>
+#include <interrupt/irq.h>
+#include <mutex.h>
+#include <spinlock.h>
+
+#ifdef LOCK_STATS
+struct LockReport {
+    const void* lock;
+    const char* name;
+
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t totalWait;
+    uint64_t maxWait;
+    uint64_t maxHold;
+};
+
+// The registry is taken from inside Spinlock::Acquire, so it uses the raw lock word to avoid measuring itself
+LockStats* registry[LOCK_STATS_MAX];
+uint64_t registryLock = 0;
+uint64_t droppedLocks = 0;
+
+LockReport reports[LOCK_STATS_MAX];
+Mutex reportMutex("lockstat report");
+
+LockStats::~LockStats() {
+    if (!registered)
+        return;
+
+    uint64_t flags = Interrupt::Disable();
+    AcquireSpinlock(&registryLock);
+
+    for (uint64_t i = 0; i < LOCK_STATS_MAX; i++) {
+        if (registry[i] == this) {
+            registry[i] = nullptr;
+            break;
+        }
+    }
+
+    ReleaseSpinlock(&registryLock);
+    Interrupt::Restore(flags);
+}
+
+void LockStats::Acquired(uint64_t start, bool wasContended) {
+    uint64_t now = ReadTSC();
+
+    // Locks register on first use, so locks that are never taken cost nothing
+    if (!registered) {
+        uint64_t flags = Interrupt::Disable();
+        AcquireSpinlock(&registryLock);
+
+        registered = true;
+        uint64_t i;
+        for (i = 0; i < LOCK_STATS_MAX; i++) {
+            if (registry[i] == nullptr) {
+                registry[i] = this;
+                break;
+            }
+        }
+
+        if (i == LOCK_STATS_MAX) {
+            registered = false;
+            droppedLocks++;
+        }
+
+        ReleaseSpinlock(&registryLock);
+        Interrupt::Restore(flags);
+    }
+
+    acquisitions++;
+    if (wasContended) {
+        contended++;
+
+        uint64_t wait = now - start;
+        totalWait += wait;
+        if (wait > maxWait)
+            maxWait = wait;
+    }
+
+    holdStart = now;
+}
+
+void LockStats::Released() {
+    uint64_t hold = ReadTSC() - holdStart;
+    if (hold > maxHold)
+        maxHold = hold;
+}
+
+uint64_t PrintLockStats(uint64_t numLocks) {
+    reportMutex.Lock();
+
+    // Take a snapshot so no lock can be destroyed while it is being printed
+    uint64_t flags = Interrupt::Disable();
+    AcquireSpinlock(&registryLock);
+
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < LOCK_STATS_MAX; i++) {
+        LockStats* stats = registry[i];
+        if (stats == nullptr)
+            continue;
+
+        reports[count++] = {stats, stats->name, stats->acquisitions, stats->contended, stats->totalWait, stats->maxWait, stats->maxHold};
+    }
+
+    uint64_t dropped = droppedLocks;
+
+    ReleaseSpinlock(&registryLock);
+    Interrupt::Restore(flags);
+
+    Console::Println("[ Lock ] %lli locks tracked (%lli untracked), wait and hold times in TSC cycles", count, dropped);
+
+    // Repeatedly pick the most contended remaining lock, the table is small
+    for (uint64_t n = 0; n < numLocks && n < count; n++) {
+        uint64_t most = n;
+        for (uint64_t i = n + 1; i < count; i++)
+            if (reports[i].contended > reports[most].contended)
+                most = i;
+
+        LockReport report = reports[most];
+        reports[most] = reports[n];
+        reports[n] = report;
+
+        uint64_t averageWait = report.contended == 0 ? 0 : report.totalWait / report.contended;
+        if (report.name == nullptr)
+            Console::Println("    %#llx: %lli/%lli contended, wait %lli avg %lli max, hold %lli max", report.lock, report.contended, report.acquisitions, averageWait, report.maxWait, report.maxHold);
+        else
+            Console::Println("    %s: %lli/%lli contended, wait %lli avg %lli max, hold %lli max", report.name, report.contended, report.acquisitions, averageWait, report.maxWait, report.maxHold);
+    }
+
+    reportMutex.Unlock();
+
+    return count;
+}
+#else
+uint64_t PrintLockStats(uint64_t numLocks) {
+    errno = ERROR_NOT_IMPLEMENTED;
+    return ~0;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include <memory/physical.h>
+
+#include <console.h>
+#include <interrupt/irq.h>
+#include <mutex.h>
+#include <process/futex.h>
+#include <process/process.h>
+#include <string.h>
+#include <time.h>
+
+#include "physical.h"
+#include "virtual.h"
+
+// Blocks more than half full are not worth the copying
+#define COMPACTION_MAXIMUM_USAGE (PAGES_PER_LARGE_PAGE / 2)
+// Each pass walks every address space, so passes are spaced out (in milliseconds)
+#define COMPACTION_MINIMUM_INTERVAL 1000
+
+namespace Memory { namespace Physical {
+    struct CompactionStats {
+        uint64_t runs;
+        uint64_t pagesMigrated;
+        uint64_t pagesPinned;
+        uint64_t blocksFreed;
+        uint64_t blocksFailed;
+    };
+
+    CompactionStats compactionStats;
+    Mutex compactionMutex("heap compaction");
+
+    time_t lastCompaction;
+    bool compactionStarted;
+    // Set once the targets have reached the block being emptied
+    bool targetsExhausted;
+
+    // Moves the page referenced by entry out of the block being emptied
+    // User pages are never shared between address spaces, so each page has exactly one entry
+    bool MigrateEntry(uint64_t* entry, PhysicalAddress block, uint64_t* isolated) {
+        if ((*entry & PAGE_PRESENT) == 0)
+            return false;
+
+        PhysicalAddress oldPage = *entry & ~(PAGE_SIZE - 1);
+        if (oldPage < block || oldPage >= block + LARGE_PAGE_SIZE)
+            return false;
+
+        // Targets come from the top of memory so the emptied block isn't refilled
+        // Once they reach the block there is nothing left above it to move into
+        PhysicalAddress newPage = AllocateHigh();
+        if (newPage < block) {
+            if (newPage != 0)
+                Free(newPage);
+
+            targetsExhausted = true;
+            return false;
+        }
+
+        // The owner must not run between the copy and the entry update
+        uint64_t flags = Interrupt::Disable();
+
+        // Futex waiters are keyed by the old address and would never be woken, so their pages stay put
+        if (FutexPageHasWaiters(oldPage)) {
+            Interrupt::Restore(flags);
+            Free(newPage);
+            compactionStats.pagesPinned++;
+            return false;
+        }
+
+        memcpy((void*)(newPage + KERNEL_VMA), (void*)(oldPage + KERNEL_VMA), PAGE_SIZE);
+        *entry = newPage | (*entry & (PAGE_SIZE - 1));
+        FutexPageMoved();
+        Interrupt::Restore(flags);
+
+        // Keep the old page for the block instead of freeing it
+        uint64_t page = (oldPage - block) / PAGE_SIZE;
+        isolated[page / 64] |= (uint64_t)1 << (page % 64);
+
+        compactionStats.pagesMigrated++;
+        return true;
+    }
+
+    void MigrateAddressSpace(Process* process, PhysicalAddress block, uint64_t* isolated) {
+        bool changed = false;
+        PML4* pml4 = (PML4*)(process->pagingStructure + KERNEL_VMA);
+
+        process->pagingStructureMutex.Lock();
+        for (int i = 0; i < 256; i++) {
+            changed |= MigrateEntry(&pml4->entries[i], block, isolated);
+            if ((pml4->entries[i] & PAGE_PRESENT) == 0)
+                continue;
+
+            PDPT* pdpt = pml4->GetEntry(i);
+            for (int j = 0; j < 512; j++) {
+                changed |= MigrateEntry(&pdpt->entries[j], block, isolated);
+                if ((pdpt->entries[j] & PAGE_PRESENT) == 0)
+                    continue;
+
+                PageDirectory* pageDirectory = pdpt->GetEntry(j);
+                for (int k = 0; k < 512; k++) {
+                    changed |= MigrateEntry(&pageDirectory->entries[k], block, isolated);
+                    if ((pageDirectory->entries[k] & PAGE_PRESENT) == 0)
+                        continue;
+
+                    PageTable* pageTable = pageDirectory->GetEntry(k);
+                    for (int l = 0; l < 512; l++)
+                        changed |= MigrateEntry(&pageTable->entries[l], block, isolated);
+                }
+            }
+        }
+
+        // Flush the stale translations if this is the loaded address space
+        if (changed && GetCR3() == process->pagingStructure)
+            SetCurrentPML4(process->pagingStructure);
+
+        process->pagingStructureMutex.Unlock();
+    }
+
+    // Returns true if the block was emptied and freed
+    bool CompactBlock(PhysicalAddress block) {
+        uint64_t isolated[BITMAP_WORDS_PER_LARGE_PAGE];
+        IsolateBlock(block, isolated);
+
+        processHashLock.LockShared();
+        HashMap<uint64_t, Process*>::Iterator iter(&processHash);
+        while (iter.Next())
+            MigrateAddressSpace(*iter.value, block, isolated);
+        processHashLock.UnlockShared();
+
+        // Anything left belongs to the kernel or is pinned and can't be moved
+        for (uint64_t i = 0; i < BITMAP_WORDS_PER_LARGE_PAGE; i++) {
+            if (isolated[i] != 0xFFFFFFFFFFFFFFFF) {
+                ReleaseBlock(block, isolated);
+                compactionStats.blocksFailed++;
+                return false;
+            }
+        }
+
+        // Every page in the block is now held in isolated, so this frees all of it
+        ReleaseBlock(block, isolated);
+        compactionStats.blocksFreed++;
+        return true;
+    }
+
+    uint64_t Compact(uint64_t numBlocks) {
+        compactionMutex.Lock();
+
+        time_t now = GetCurrentTime();
+        if (compactionStarted && now - lastCompaction < COMPACTION_MINIMUM_INTERVAL) {
+            compactionMutex.Unlock();
+            return ~0;
+        }
+
+        compactionStarted = true;
+        lastCompaction = now;
+        targetsExhausted = false;
+        compactionStats.runs++;
+
+        // Block 0 is never handed out
+        uint64_t assembled = 0;
+        for (uint64_t next = 1; next < GetNumBlocks() && assembled < numBlocks && !targetsExhausted; next++) {
+            // Emptying a block needs a block worth of free pages elsewhere
+            if (GetFreePages() < PAGES_PER_LARGE_PAGE)
+                break;
+
+            PhysicalAddress block = next * LARGE_PAGE_SIZE;
+            uint64_t usage = GetBlockUsage(block);
+            if (usage == 0 || usage > COMPACTION_MAXIMUM_USAGE)
+                continue;
+
+            if (CompactBlock(block))
+                assembled++;
+        }
+
+        compactionMutex.Unlock();
+
+        return assembled;
+    }
+
+    void PrintCompactionStats() {
+        compactionMutex.Lock();
+        CompactionStats stats = compactionStats;
+        compactionMutex.Unlock();
+
+        Console::Println("[ Compaction ] %lli runs, %lli pages migrated, %lli pinned by futexes", stats.runs, stats.pagesMigrated, stats.pagesPinned);
+        Console::Println("[ Compaction ] %lli blocks freed, %lli failed, %lli of %lli pages free", stats.blocksFreed, stats.blocksFailed, GetFreePages(), GetTotalPages());
+    }
+}} // namespace Memory::Physical
\ No newline at end of file
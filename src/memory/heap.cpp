@@ -1,14 +1,18 @@
 #include <memory/heap.h>
 
+#include <interrupt/irq.h>
 #include <memory/defs.h>
-#include <mutex.h>
+#include <memory/virtual.h>
 #include <panic.h>
 #include <stddef.h>
+#include <string.h>
 
-#include "physical.h"
+#include "heap.h"
+#include "virtual.h"
 
-void* operator new(size_t size) { return Memory::Heap::Allocate(size); }
-void* operator new[](size_t size) { return Memory::Heap::Allocate(size); }
+// The return address is the call site when profiling
+void* operator new(size_t size) { return Memory::Heap::AllocateFrom(size, 1, __builtin_return_address(0)); }
+void* operator new[](size_t size) { return Memory::Heap::AllocateFrom(size, 1, __builtin_return_address(0)); }
 
 void operator delete(void* p) { Memory::Heap::Free(p); }
 void operator delete(void* p, unsigned long) { Memory::Heap::Free(p); }
@@ -17,32 +21,316 @@ void operator delete[](void* p) { Memory::Heap::Free(p); }
 void operator delete[](void* p, unsigned long) { Memory::Heap::Free(p); }
 
 namespace Memory { namespace Heap {
-    uint64_t top;
-    Mutex topMutex;
+    SizeClass sizeClasses[HEAP_NUM_SIZE_CLASSES];
 
-    extern "C" void InitHeap() { top = KERNEL_VMA + 0x100000000000; }
+    extern "C" void InitHeap() {
+        uint64_t size = HEAP_MINIMUM_SIZE;
+        for (int i = 0; i < HEAP_NUM_SIZE_CLASSES; i++, size <<= 1) {
+            SizeClass* sizeClass = &sizeClasses[i];
+            sizeClass->size = size;
+            sizeClass->slabSize = size * 16 < PAGE_SIZE ? PAGE_SIZE : size * 16;
+            sizeClass->firstObject = (sizeof(Slab) + size - 1) & ~(size - 1);
+            sizeClass->objectsPerSlab = (sizeClass->slabSize - sizeClass->firstObject) / size;
+            sizeClass->base = HEAP_SLAB_BASE + i * HEAP_SLAB_SPAN;
+        }
 
-    void* Allocate(uint64_t size) {
-        topMutex.Lock();
-        void* ret = (void*)top;
-        top += size;
-        topMutex.Unlock();
+        Virtual::InitKernelRanges();
+    }
 
-        return ret;
+    inline int GetSizeClass(uint64_t size) {
+        if (size <= HEAP_MINIMUM_SIZE)
+            return 0;
+
+        return 64 - __builtin_clzll(size - 1) - 3;
+    }
+
+    inline void PushSlab(Slab*& list, Slab* slab) {
+        slab->prev = nullptr;
+        slab->next = list;
+        if (list != nullptr)
+            list->prev = slab;
+        list = slab;
+    }
+
+    inline void RemoveSlab(Slab*& list, Slab* slab) {
+        if (slab->prev != nullptr)
+            slab->prev->next = slab->next;
+        else
+            list = slab->next;
+
+        if (slab->next != nullptr)
+            slab->next->prev = slab->prev;
+    }
+
+    // Maps and formats a new slab, called without the class lock held
+    Slab* CreateSlab(SizeClass* sizeClass) {
+        uint64_t flags = sizeClass->lock.AcquireIRQ();
+        uint64_t address;
+        if (sizeClass->numFreeSlabs > 0)
+            address = sizeClass->freeSlabs[--sizeClass->numFreeSlabs];
+        else {
+            if ((sizeClass->nextSlab + 1) * sizeClass->slabSize > HEAP_SLAB_SPAN)
+                panic("Kernel heap exhausted for %i byte objects!", sizeClass->size);
+
+            address = sizeClass->base + sizeClass->nextSlab * sizeClass->slabSize;
+            sizeClass->nextSlab++;
+        }
+        sizeClass->lock.ReleaseIRQ(flags);
+
+        Virtual::AllocatePages((VirtualAddress)address, sizeClass->slabSize / PAGE_SIZE);
+
+        Slab* slab = (Slab*)address;
+        slab->next = nullptr;
+        slab->prev = nullptr;
+        slab->inUse = 0;
+
+        // Build the free list from the top so objects are handed out in address order
+        slab->freeList = nullptr;
+        for (uint64_t i = sizeClass->objectsPerSlab; i > 0; i--) {
+            void** object = (void**)(address + sizeClass->firstObject + (i - 1) * sizeClass->size);
+            *object = slab->freeList;
+            slab->freeList = object;
+        }
+
+        return slab;
+    }
+
+    // The class locks are only held for list updates, with interrupts disabled as the CPU caches are
+    // Creating and releasing slabs drops them first, the page tables and physical bitmap behind a Mutex may sleep
+    void* AllocateSmall(SizeClass* sizeClass) {
+        uint64_t flags = sizeClass->lock.AcquireIRQ();
+
+        Slab* slab = sizeClass->partial;
+        if (slab == nullptr) {
+            slab = sizeClass->empty;
+            if (slab != nullptr) {
+                RemoveSlab(sizeClass->empty, slab);
+                sizeClass->numEmpty--;
+            } else {
+                sizeClass->lock.ReleaseIRQ(flags);
+                slab = CreateSlab(sizeClass);
+                flags = sizeClass->lock.AcquireIRQ();
+            }
+
+            PushSlab(sizeClass->partial, slab);
+        }
+
+        void** object = (void**)slab->freeList;
+        slab->freeList = *object;
+        slab->inUse++;
+
+        if (slab->inUse == sizeClass->objectsPerSlab)
+            RemoveSlab(sizeClass->partial, slab);
+
+        sizeClass->lock.ReleaseIRQ(flags);
+
+        return object;
+    }
+
+    void FreeSmall(SizeClass* sizeClass, void* ptr) {
+        Slab* slab = (Slab*)((uint64_t)ptr & ~(sizeClass->slabSize - 1));
+
+        uint64_t flags = sizeClass->lock.AcquireIRQ();
+
+        *(void**)ptr = slab->freeList;
+        slab->freeList = ptr;
+
+        if (slab->inUse == sizeClass->objectsPerSlab)
+            PushSlab(sizeClass->partial, slab);
+
+        slab->inUse--;
+        if (slab->inUse > 0) {
+            sizeClass->lock.ReleaseIRQ(flags);
+            return;
+        }
+
+        RemoveSlab(sizeClass->partial, slab);
+
+        // Keep a few empty slabs around, beyond that give the pages back
+        if (sizeClass->numEmpty < HEAP_CACHED_EMPTY_SLABS || sizeClass->numFreeSlabs + sizeClass->numReleasing >= HEAP_FREE_SLAB_ADDRESSES) {
+            PushSlab(sizeClass->empty, slab);
+            sizeClass->numEmpty++;
+            sizeClass->lock.ReleaseIRQ(flags);
+            return;
+        }
+
+        sizeClass->numReleasing++;
+        sizeClass->lock.ReleaseIRQ(flags);
+
+        // The address is only reusable once the pages are unmapped
+        Virtual::FreePages((VirtualAddress)slab, sizeClass->slabSize / PAGE_SIZE);
+
+        flags = sizeClass->lock.AcquireIRQ();
+        sizeClass->numReleasing--;
+        sizeClass->freeSlabs[sizeClass->numFreeSlabs++] = (uint64_t)slab;
+        sizeClass->lock.ReleaseIRQ(flags);
+    }
+
+    inline CPUCache* GetCPUCache(SizeClass* sizeClass) { return &sizeClass->cpuCaches[0]; }
+
+    // A missing magazine can neither give nor take objects
+    inline bool IsEmpty(Magazine* magazine) { return magazine == nullptr || magazine->rounds == 0; }
+    inline bool IsFull(Magazine* magazine) { return magazine == nullptr || magazine->rounds == HEAP_MAGAZINE_SIZE; }
+
+    inline void PushMagazine(Magazine*& list, Magazine* magazine) {
+        magazine->next = list;
+        list = magazine;
     }
 
-    void* AllocateAligned(uint64_t size, uint64_t alignment) {
-        topMutex.Lock();
-        if (top % alignment == 0) {
-            topMutex.Unlock();
-            return Allocate(size);
+    inline Magazine* PopMagazine(Magazine*& list) {
+        Magazine* magazine = list;
+        list = magazine->next;
+        return magazine;
+    }
+
+    // Fast path, only the depot lock is shared and it is taken once per magazine
+    void* AllocateCached(SizeClass* sizeClass) {
+        uint64_t flags = Interrupt::Disable();
+        CPUCache* cache = GetCPUCache(sizeClass);
+
+        if (IsEmpty(cache->loaded)) {
+            if (!IsEmpty(cache->previous)) {
+                Magazine* magazine = cache->loaded;
+                cache->loaded = cache->previous;
+                cache->previous = magazine;
+            } else {
+                Depot* depot = &sizeClass->depot;
+                depot->lock.Acquire();
+                if (depot->full == nullptr) {
+                    depot->lock.Release();
+                    Interrupt::Restore(flags);
+                    return AllocateSmall(sizeClass);
+                }
+
+                if (cache->previous != nullptr)
+                    PushMagazine(depot->empty, cache->previous);
+                cache->previous = cache->loaded;
+                cache->loaded = PopMagazine(depot->full);
+                depot->numFull--;
+                depot->lock.Release();
+            }
         }
 
-        top = top - (top % alignment) + alignment;
-        topMutex.Unlock();
+        void* ptr = cache->loaded->objects[--cache->loaded->rounds];
+        Interrupt::Restore(flags);
+        return ptr;
+    }
+
+    void FreeCached(SizeClass* sizeClass, void* ptr) {
+        while (1) {
+            uint64_t flags = Interrupt::Disable();
+            CPUCache* cache = GetCPUCache(sizeClass);
+
+            if (IsFull(cache->loaded)) {
+                if (!IsFull(cache->previous)) {
+                    Magazine* magazine = cache->loaded;
+                    cache->loaded = cache->previous;
+                    cache->previous = magazine;
+                } else {
+                    Depot* depot = &sizeClass->depot;
+                    depot->lock.Acquire();
+
+                    // Don't let the depot hoard memory the slabs could release
+                    if (depot->numFull >= HEAP_DEPOT_MAXIMUM_FULL) {
+                        depot->lock.Release();
+                        Interrupt::Restore(flags);
+                        FreeSmall(sizeClass, ptr);
+                        return;
+                    }
+
+                    if (depot->empty == nullptr) {
+                        depot->lock.Release();
+                        Interrupt::Restore(flags);
+
+                        // Magazines come straight from the slabs so this can't recurse
+                        Magazine* magazine = (Magazine*)AllocateSmall(&sizeClasses[HEAP_MAGAZINE_CLASS]);
+                        magazine->rounds = 0;
+
+                        flags = depot->lock.AcquireIRQ();
+                        PushMagazine(depot->empty, magazine);
+                        depot->lock.ReleaseIRQ(flags);
+                        continue;
+                    }
+
+                    if (cache->previous != nullptr) {
+                        PushMagazine(depot->full, cache->previous);
+                        depot->numFull++;
+                    }
+                    cache->previous = cache->loaded;
+                    cache->loaded = PopMagazine(depot->empty);
+                    depot->lock.Release();
+                }
+            }
 
-        return Allocate(size);
+            cache->loaded->objects[cache->loaded->rounds++] = ptr;
+            Interrupt::Restore(flags);
+            return;
+        }
+    }
+
+    void* AllocateFrom(uint64_t size, uint64_t alignment, void* caller) {
+        if (alignment > PAGE_SIZE)
+            panic("Heap allocations can't be aligned beyond a page (%#llx)", alignment);
+
+        // Objects are aligned to their size class, larger allocations to a page
+        void* ptr;
+        uint64_t classSize = size < alignment ? alignment : size;
+        if (classSize <= HEAP_MAXIMUM_SLAB_OBJECT)
+            ptr = AllocateCached(&sizeClasses[GetSizeClass(classSize)]);
+        else
+            ptr = Virtual::AllocateKernelRange((size + PAGE_SIZE - 1) / PAGE_SIZE);
+
+#ifdef HEAP_PROFILE
+        ProfileAllocate(ptr, size, caller);
+#endif
+
+        return ptr;
+    }
+
+    void* Allocate(uint64_t size) { return AllocateFrom(size, 1, __builtin_return_address(0)); }
+    void* AllocateAligned(uint64_t size, uint64_t alignment) { return AllocateFrom(size, alignment, __builtin_return_address(0)); }
+
+    void Free(void* ptr) {
+#ifdef HEAP_PROFILE
+        if (ptr != nullptr)
+            ProfileFree(ptr);
+#endif
+
+        uint64_t address = (uint64_t)ptr;
+        if (address >= HEAP_SLAB_BASE && address < HEAP_SLAB_BASE + HEAP_NUM_SIZE_CLASSES * HEAP_SLAB_SPAN)
+            FreeCached(&sizeClasses[(address - HEAP_SLAB_BASE) / HEAP_SLAB_SPAN], ptr);
+        else if (address >= KERNEL_RANGE_BASE && address < KERNEL_RANGE_END)
+            Virtual::FreeKernelRange(ptr);
     }
 
-    void Free(void* ptr) {}
+    void* Reallocate(void* ptr, uint64_t size) {
+        if (ptr == nullptr)
+            return AllocateFrom(size, 1, __builtin_return_address(0));
+
+        uint64_t address = (uint64_t)ptr;
+        uint64_t oldSize;
+        bool inPlace;
+        if (address >= HEAP_SLAB_BASE && address < HEAP_SLAB_BASE + HEAP_NUM_SIZE_CLASSES * HEAP_SLAB_SPAN) {
+            // Keep it while it still belongs in the same size class
+            oldSize = sizeClasses[(address - HEAP_SLAB_BASE) / HEAP_SLAB_SPAN].size;
+            inPlace = size <= oldSize && (size > oldSize / 2 || oldSize == HEAP_MINIMUM_SIZE);
+        } else {
+            oldSize = Virtual::GetKernelRangePages(ptr) * PAGE_SIZE;
+            inPlace = size > HEAP_MAXIMUM_SLAB_OBJECT && Virtual::ExtendKernelRange(ptr, (size + PAGE_SIZE - 1) / PAGE_SIZE);
+        }
+
+        if (inPlace) {
+#ifdef HEAP_PROFILE
+            ProfileFree(ptr);
+            ProfileAllocate(ptr, size, __builtin_return_address(0));
+#endif
+            return ptr;
+        }
+
+        void* ret = AllocateFrom(size, 1, __builtin_return_address(0));
+        memcpy(ret, ptr, size < oldSize ? size : oldSize);
+        Free(ptr);
+
+        return ret;
+    }
 }} // namespace Memory::Heap
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory/defs.h>
+#include <spinlock.h>
+
+// Each size class owns a span of the slab region so Free can find a slab from any address
+#define HEAP_SLAB_BASE (KERNEL_VMA + 0x100000000000)
+#define HEAP_SLAB_SPAN (64 * GIGABYTE)
+
+#define HEAP_MINIMUM_SIZE 8
+#define HEAP_MAXIMUM_SLAB_OBJECT (4 * KILOBYTE)
+#define HEAP_NUM_SIZE_CLASSES 10
+
+// Fully free slabs kept mapped per size class before pages go back to physical memory
+#define HEAP_CACHED_EMPTY_SLABS 1
+#define HEAP_FREE_SLAB_ADDRESSES 64
+
+// Objects per magazine, chosen so a magazine fills a 128 byte object
+#define HEAP_MAGAZINE_SIZE 14
+#define HEAP_MAGAZINE_CLASS 4
+
+// Full magazines kept in a depot before frees go straight back to the slabs
+#define HEAP_DEPOT_MAXIMUM_FULL 8
+
+// Only the bootstrap processor runs the kernel
+#define HEAP_NUM_CPUS 1
+
+// Define HEAP_PROFILE to record the call site, size and time of every live allocation
+#define HEAP_PROFILE_ALLOCATIONS 16384
+#define HEAP_PROFILE_SITES 1024
+
+namespace Memory { namespace Heap {
+    // Lives at the start of every slab, objects follow it
+    struct Slab {
+        Slab* next;
+        Slab* prev;
+        void* freeList;
+        uint64_t inUse;
+    };
+
+    struct Magazine {
+        Magazine* next;
+        uint64_t rounds;
+        void* objects[HEAP_MAGAZINE_SIZE];
+    };
+
+    // Only touched by its own processor with interrupts disabled, so it needs no lock
+    struct CPUCache {
+        Magazine* loaded;
+        Magazine* previous;
+    };
+
+    struct Depot {
+        Spinlock lock;
+
+        Magazine* full;
+        Magazine* empty;
+        uint64_t numFull;
+    };
+
+    struct SizeClass {
+        CPUCache cpuCaches[HEAP_NUM_CPUS];
+        Depot depot;
+
+        Spinlock lock;
+
+        uint64_t size;
+        uint64_t slabSize;
+        uint64_t firstObject;
+        uint64_t objectsPerSlab;
+
+        // Slabs with at least one free and one used object, full slabs are on no list
+        Slab* partial;
+        Slab* empty;
+        uint64_t numEmpty;
+
+        uint64_t base;
+        uint64_t nextSlab;
+
+        // Addresses of released slabs, reused before the span grows
+        uint64_t freeSlabs[HEAP_FREE_SLAB_ADDRESSES];
+        uint64_t numFreeSlabs;
+        uint64_t numReleasing;
+    };
+
+    void* AllocateFrom(uint64_t size, uint64_t alignment, void* caller);
+
+#ifdef HEAP_PROFILE
+    void ProfileAllocate(void* ptr, uint64_t size, void* caller);
+    void ProfileFree(void* ptr);
+#endif
+}} // namespace Memory::Heap
\ No newline at end of file
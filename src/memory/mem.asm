@@ -6,4 +6,9 @@ SetCurrentPML4:
 GLOBAL GetCR2
 GetCR2:
     mov rax, cr2
+    ret
+
+GLOBAL GetCR3
+GetCR3:
+    mov rax, cr3
     ret
\ No newline at end of file
@@ -16,7 +16,7 @@ uint64_t KERNEL_SIZE;
 namespace Memory { namespace Physical {
     uint64_t bitmapSize;
     uint64_t bitmap[PHYSICAL_BITMAP_SIZE];
-    Mutex bitmapMutex;
+    Mutex bitmapMutex("physical bitmap");
 
     PhysicalAddress nextFreePage;
 
@@ -92,9 +92,12 @@ namespace Memory { namespace Physical {
             Allocate(addr);
     }
 
+    inline uint64_t BitmapIndex(PhysicalAddress addr) { return addr / (PAGE_SIZE * 64); }
+    inline uint64_t BitmapBit(PhysicalAddress addr) { return (addr / PAGE_SIZE) % 64; }
+
     bool IsPageFree(PhysicalAddress addr) {
-        uint64_t i = addr / PAGE_SIZE / 64;
-        uint64_t b = 64 - ((addr / PAGE_SIZE) % 64);
+        uint64_t i = BitmapIndex(addr);
+        uint64_t b = BitmapBit(addr);
 
         if (i >= bitmapSize)
             return false;
@@ -103,8 +106,8 @@ namespace Memory { namespace Physical {
     }
 
     void Allocate(PhysicalAddress addr) {
-        uint64_t i = addr / (PAGE_SIZE * 64);
-        uint64_t b = 64 - ((addr / PAGE_SIZE) % 64);
+        uint64_t i = BitmapIndex(addr);
+        uint64_t b = BitmapBit(addr);
 
         if (i >= bitmapSize)
             return;
@@ -117,33 +120,118 @@ namespace Memory { namespace Physical {
 
         numFreePages--;
 
-        bitmap[i] |= 1 << b;
+        bitmap[i] |= (uint64_t)1 << b;
+
+        bitmapMutex.Unlock();
+    }
+
+    inline bool IsBlockFree(uint64_t idx) {
+        for (uint64_t i = 0; i < BITMAP_WORDS_PER_LARGE_PAGE; i++)
+            if (bitmap[idx + i] != 0)
+                return false;
+
+        return true;
+    }
+
+    inline PhysicalAddress TakePage(uint64_t i) {
+        uint64_t b = __builtin_ctzll(~bitmap[i]);
+        bitmap[i] |= (uint64_t)1 << b;
+        numFreePages--;
+
+        return (i * 64 + b) * PAGE_SIZE;
+    }
+
+    // Pages are taken from blocks already in use before a whole free block is broken up
+    // nextFreePage is a hint, every page below it is allocated or part of a whole free block
+    PhysicalAddress Allocate() {
+        bitmapMutex.Lock();
+
+        uint64_t freeBlock = bitmapSize;
+        for (uint64_t i = BitmapIndex(nextFreePage); i < bitmapSize; i++) {
+            if (bitmap[i] == 0xFFFFFFFFFFFFFFFF)
+                continue;
 
-        if (addr == nextFreePage) {
-            for (i = nextFreePage; i < bitmapSize * 64 * PAGE_SIZE; i += PAGE_SIZE) {
-                if (IsPageFree(i)) {
-                    nextFreePage = i;
+            if (i % BITMAP_WORDS_PER_LARGE_PAGE == 0 && IsBlockFree(i)) {
+                if (freeBlock == bitmapSize)
+                    freeBlock = i;
+
+                i += BITMAP_WORDS_PER_LARGE_PAGE - 1;
+                continue;
+            }
+
+            PhysicalAddress ret = TakePage(i);
+            nextFreePage = ret;
+
+            bitmapMutex.Unlock();
+            return ret;
+        }
+
+        // Whole free blocks below the hint are only found by wrapping around
+        if (freeBlock == bitmapSize) {
+            for (uint64_t i = 0; i < bitmapSize; i++) {
+                if (bitmap[i] != 0xFFFFFFFFFFFFFFFF) {
+                    freeBlock = i;
                     break;
                 }
             }
         }
 
+        if (freeBlock != bitmapSize) {
+            PhysicalAddress ret = TakePage(freeBlock);
+            nextFreePage = ret;
+
+            bitmapMutex.Unlock();
+            return ret;
+        }
+
         bitmapMutex.Unlock();
+
+        panic("Out of physical memory!");
+        return 0;
     }
 
-    PhysicalAddress Allocate() {
+    PhysicalAddress AllocateHigh() {
         bitmapMutex.Lock();
-        PhysicalAddress ret = nextFreePage;
+
+        for (uint64_t i = bitmapSize; i-- > 0;) {
+            if (bitmap[i] == 0xFFFFFFFFFFFFFFFF)
+                continue;
+
+            uint64_t b = 63 - __builtin_clzll(~bitmap[i]);
+            bitmap[i] |= (uint64_t)1 << b;
+            numFreePages--;
+
+            bitmapMutex.Unlock();
+            return (i * 64 + b) * PAGE_SIZE;
+        }
+
         bitmapMutex.Unlock();
+        return 0;
+    }
+
+    PhysicalAddress AllocateLarge() {
+        bitmapMutex.Lock();
+
+        // Block 0 holds the low memory used by firmware and is never handed out
+        for (uint64_t i = BITMAP_WORDS_PER_LARGE_PAGE; i + BITMAP_WORDS_PER_LARGE_PAGE <= bitmapSize; i += BITMAP_WORDS_PER_LARGE_PAGE) {
+            if (!IsBlockFree(i))
+                continue;
 
-        Allocate(nextFreePage);
+            for (uint64_t j = 0; j < BITMAP_WORDS_PER_LARGE_PAGE; j++)
+                bitmap[i + j] = 0xFFFFFFFFFFFFFFFF;
+            numFreePages -= PAGES_PER_LARGE_PAGE;
 
-        return ret;
+            bitmapMutex.Unlock();
+            return i * 64 * PAGE_SIZE;
+        }
+
+        bitmapMutex.Unlock();
+        return 0;
     }
 
     void Free(PhysicalAddress addr) {
-        uint64_t i = addr / (PAGE_SIZE * 64);
-        uint64_t b = 64 - ((addr / PAGE_SIZE) % 64);
+        uint64_t i = BitmapIndex(addr);
+        uint64_t b = BitmapBit(addr);
 
         if (i >= bitmapSize)
             return;
@@ -156,11 +244,49 @@ namespace Memory { namespace Physical {
 
         numFreePages++;
 
-        bitmap[i] &= ~(1 << b);
+        bitmap[i] &= ~((uint64_t)1 << b);
+
+        if (addr < nextFreePage)
+            nextFreePage = addr;
+
+        bitmapMutex.Unlock();
+    }
+
+    void IsolateBlock(PhysicalAddress block, uint64_t* isolated) {
+        uint64_t idx = BitmapIndex(block);
 
+        bitmapMutex.Lock();
+        for (uint64_t i = 0; i < BITMAP_WORDS_PER_LARGE_PAGE; i++) {
+            isolated[i] = ~bitmap[idx + i];
+            bitmap[idx + i] = 0xFFFFFFFFFFFFFFFF;
+            numFreePages -= __builtin_popcountll(isolated[i]);
+        }
         bitmapMutex.Unlock();
     }
 
+    void ReleaseBlock(PhysicalAddress block, uint64_t* isolated) {
+        uint64_t idx = BitmapIndex(block);
+
+        bitmapMutex.Lock();
+        for (uint64_t i = 0; i < BITMAP_WORDS_PER_LARGE_PAGE; i++) {
+            bitmap[idx + i] &= ~isolated[i];
+            numFreePages += __builtin_popcountll(isolated[i]);
+        }
+        bitmapMutex.Unlock();
+    }
+
+    uint64_t GetBlockUsage(PhysicalAddress block) {
+        uint64_t idx = BitmapIndex(block);
+        uint64_t used = 0;
+
+        for (uint64_t i = 0; i < BITMAP_WORDS_PER_LARGE_PAGE; i++)
+            used += __builtin_popcountll(bitmap[idx + i]);
+
+        return used;
+    }
+
+    uint64_t GetNumBlocks() { return bitmapSize / BITMAP_WORDS_PER_LARGE_PAGE; }
+
     uint64_t GetTotalPages() { return numTotalPages; }
     uint64_t GetFreePages() { return numFreePages; }
 }} // namespace Memory::Physical
\ No newline at end of file
@@ -3,4 +3,22 @@
 #include <memory/defs.h>
 
 #define MAXIMUM_SYSTEM_MEMORY (128 * GIGABYTE)
-#define PHYSICAL_BITMAP_SIZE (MAXIMUM_SYSTEM_MEMORY / (PAGE_SIZE * 64))
\ No newline at end of file
+#define PHYSICAL_BITMAP_SIZE (MAXIMUM_SYSTEM_MEMORY / (PAGE_SIZE * 64))
+
+#define PAGES_PER_LARGE_PAGE (LARGE_PAGE_SIZE / PAGE_SIZE)
+#define BITMAP_WORDS_PER_LARGE_PAGE (PAGES_PER_LARGE_PAGE / 64)
+
+namespace Memory { namespace Physical {
+    // Marks every free page in the block as allocated so it can be emptied
+    // The claimed pages are recorded in isolated
+    void IsolateBlock(PhysicalAddress block, uint64_t* isolated);
+    // Frees the pages recorded in isolated
+    // The block is left whole so the next Allocate does not break it up again
+    void ReleaseBlock(PhysicalAddress block, uint64_t* isolated);
+
+    // Allocates the highest free page, returns 0 when memory is full
+    PhysicalAddress AllocateHigh();
+
+    uint64_t GetBlockUsage(PhysicalAddress block);
+    uint64_t GetNumBlocks();
+}} // namespace Memory::Physical
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include <memory/heap.h>
+
+#include <console.h>
+#include <errno.h>
+#include <interrupt/irq.h>
+#include <mutex.h>
+#include <spinlock.h>
+#include <time.h>
+
+#include "heap.h"
+
+namespace Memory { namespace Heap {
+#ifdef HEAP_PROFILE
+    struct AllocationRecord {
+        uint64_t address;
+        void* caller;
+        uint64_t size;
+        time_t time;
+    };
+
+    struct SiteRecord {
+        void* caller;
+
+        uint64_t liveAllocations;
+        uint64_t liveBytes;
+        uint64_t totalAllocations;
+        uint64_t totalBytes;
+
+        // Only filled in when reporting
+        uint64_t leakedAllocations;
+        uint64_t leakedBytes;
+    };
+
+    // The profiler can't allocate, so everything lives in fixed tables
+    AllocationRecord allocations[HEAP_PROFILE_ALLOCATIONS];
+    SiteRecord sites[HEAP_PROFILE_SITES];
+    Spinlock profileLock("heap profile");
+
+    uint64_t liveAllocations;
+    uint64_t liveBytes;
+    uint64_t maximumLiveBytes;
+    uint64_t droppedAllocations;
+
+    SiteRecord reportSites[HEAP_PROFILE_SITES];
+    Mutex reportMutex("heap profile report");
+
+    inline uint64_t Hash(uint64_t value, uint64_t tableSize) { return ((value >> 3) * 0x9E3779B97F4A7C15) & (tableSize - 1); }
+
+    SiteRecord* FindSite(SiteRecord* table, void* caller) {
+        uint64_t i = Hash((uint64_t)caller, HEAP_PROFILE_SITES);
+        for (uint64_t probes = 0; probes < HEAP_PROFILE_SITES; probes++, i = (i + 1) & (HEAP_PROFILE_SITES - 1)) {
+            if (table[i].caller == caller)
+                return &table[i];
+
+            if (table[i].caller == nullptr) {
+                table[i].caller = caller;
+                return &table[i];
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Removes the record at index, shifting back any records that probed past it
+    void RemoveAllocation(uint64_t index) {
+        uint64_t j = index;
+        while (1) {
+            allocations[index].address = 0;
+
+            do {
+                j = (j + 1) & (HEAP_PROFILE_ALLOCATIONS - 1);
+                if (allocations[j].address == 0)
+                    return;
+
+                uint64_t home = Hash(allocations[j].address, HEAP_PROFILE_ALLOCATIONS);
+                if (index <= j ? (index < home && home <= j) : (index < home || home <= j))
+                    continue;
+
+                break;
+            } while (1);
+
+            allocations[index] = allocations[j];
+            index = j;
+        }
+    }
+
+    void ProfileAllocate(void* ptr, uint64_t size, void* caller) {
+        time_t time = GetCurrentTime();
+
+        uint64_t flags = profileLock.AcquireIRQ();
+
+        SiteRecord* site = FindSite(sites, caller);
+        if (liveAllocations >= HEAP_PROFILE_ALLOCATIONS / 2 || site == nullptr) {
+            droppedAllocations++;
+            profileLock.ReleaseIRQ(flags);
+            return;
+        }
+
+        uint64_t i = Hash((uint64_t)ptr, HEAP_PROFILE_ALLOCATIONS);
+        while (allocations[i].address != 0)
+            i = (i + 1) & (HEAP_PROFILE_ALLOCATIONS - 1);
+
+        allocations[i].address = (uint64_t)ptr;
+        allocations[i].caller = caller;
+        allocations[i].size = size;
+        allocations[i].time = time;
+
+        site->liveAllocations++;
+        site->liveBytes += size;
+        site->totalAllocations++;
+        site->totalBytes += size;
+
+        liveAllocations++;
+        liveBytes += size;
+        if (liveBytes > maximumLiveBytes)
+            maximumLiveBytes = liveBytes;
+
+        profileLock.ReleaseIRQ(flags);
+    }
+
+    void ProfileFree(void* ptr) {
+        uint64_t flags = profileLock.AcquireIRQ();
+
+        // Dropped allocations are simply not found
+        uint64_t i = Hash((uint64_t)ptr, HEAP_PROFILE_ALLOCATIONS);
+        while (allocations[i].address != 0) {
+            if (allocations[i].address == (uint64_t)ptr) {
+                SiteRecord* site = FindSite(sites, allocations[i].caller);
+                site->liveAllocations--;
+                site->liveBytes -= allocations[i].size;
+
+                liveAllocations--;
+                liveBytes -= allocations[i].size;
+
+                RemoveAllocation(i);
+                break;
+            }
+
+            i = (i + 1) & (HEAP_PROFILE_ALLOCATIONS - 1);
+        }
+
+        profileLock.ReleaseIRQ(flags);
+    }
+
+    uint64_t PrintProfile(uint64_t numSites, uint64_t minimumAge) {
+        reportMutex.Lock();
+
+        // Take a snapshot so nothing is printed with the profiler locked
+        time_t now = GetCurrentTime();
+        uint64_t flags = profileLock.AcquireIRQ();
+
+        for (uint64_t i = 0; i < HEAP_PROFILE_SITES; i++)
+            reportSites[i] = sites[i];
+
+        for (uint64_t i = 0; i < HEAP_PROFILE_ALLOCATIONS; i++) {
+            if (allocations[i].address == 0 || now - allocations[i].time < minimumAge)
+                continue;
+
+            SiteRecord* site = FindSite(reportSites, allocations[i].caller);
+            site->leakedAllocations++;
+            site->leakedBytes += allocations[i].size;
+        }
+
+        uint64_t currentAllocations = liveAllocations;
+        uint64_t currentBytes = liveBytes;
+        uint64_t maximumBytes = maximumLiveBytes;
+        uint64_t dropped = droppedAllocations;
+
+        profileLock.ReleaseIRQ(flags);
+
+        Console::Println("[ Heap ] %lli bytes in %lli live allocations (high-water mark %lli bytes, %lli untracked)", currentBytes, currentAllocations, maximumBytes, dropped);
+
+        // Repeatedly pick the largest remaining site, the table is small
+        Console::Println("[ Heap ] Top call sites by live bytes:");
+        for (uint64_t n = 0; n < numSites; n++) {
+            SiteRecord* largest = nullptr;
+            for (uint64_t i = 0; i < HEAP_PROFILE_SITES; i++)
+                if (reportSites[i].liveBytes > 0 && (largest == nullptr || reportSites[i].liveBytes > largest->liveBytes))
+                    largest = &reportSites[i];
+
+            if (largest == nullptr)
+                break;
+
+            Console::Println("    %#llx: %lli bytes in %lli allocations (%lli allocations, %lli bytes total)", largest->caller, largest->liveBytes, largest->liveAllocations, largest->totalAllocations, largest->totalBytes);
+            largest->liveBytes = 0;
+        }
+
+        Console::Println("[ Heap ] Allocations older than %lli milliseconds:", minimumAge);
+        for (uint64_t i = 0; i < HEAP_PROFILE_SITES; i++)
+            if (reportSites[i].leakedAllocations > 0)
+                Console::Println("    %#llx: %lli bytes in %lli allocations", reportSites[i].caller, reportSites[i].leakedBytes, reportSites[i].leakedAllocations);
+
+        reportMutex.Unlock();
+
+        return currentAllocations;
+    }
+#else
+    uint64_t PrintProfile(uint64_t numSites, uint64_t minimumAge) {
+        errno = ERROR_NOT_IMPLEMENTED;
+        return ~0;
+    }
+#endif
+}} // namespace Memory::Heap
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <memory/virtual.h>
+
+#include <interrupt/irq.h>
+#include <objectcache.h>
+#include <panic.h>
+#include <rbtree.h>
+#include <spinlock.h>
+
+#include "virtual.h"
+
+namespace Memory { namespace Virtual {
+    struct Range {
+        uint64_t base;
+        uint64_t size;
+
+        RBNode<Range> addressNode;
+        RBNode<Range> sizeNode;
+    };
+
+    bool AddressLess(Range* a, Range* b) { return a->base < b->base; }
+    bool SizeLess(Range* a, Range* b) { return a->size < b->size || (a->size == b->size && a->base < b->base); }
+
+    // Free ranges are kept by address to merge neighbours and by size for best fit
+    RBTree<Range, AddressLess> freeRangesByAddress;
+    RBTree<Range, SizeLess> freeRangesBySize;
+    RBTree<Range, AddressLess> allocatedRanges;
+    Spinlock rangeLock("kernel ranges");
+
+    ObjectCache<Range> rangeCache;
+
+    void InitKernelRanges() {
+        Range* range = (Range*)rangeCache.Allocate();
+        range->base = KERNEL_RANGE_BASE;
+        range->size = KERNEL_RANGE_END - KERNEL_RANGE_BASE;
+
+        freeRangesByAddress.insert(&range->addressNode, range);
+        freeRangesBySize.insert(&range->sizeNode, range);
+    }
+
+    // Caller must hold rangeLock
+    Range* FindAllocatedRange(uint64_t address) {
+        RBNode<Range>* node = allocatedRanges.lowerBound([address](Range* range) { return range->base + range->size > address; });
+        if (node == nullptr || node->value->base != address)
+            panic("Unknown kernel range (%#llx)", address);
+
+        return node->value;
+    }
+
+    // Only the heap uses the trees and it never runs in interrupt handlers
+    // Interrupts are still disabled so an interrupt can't stretch the short lock hold
+    // Pages are mapped and unmapped with it released
+    void* AllocateKernelRange(uint64_t numPages) {
+        uint64_t size = (numPages + 1) * PAGE_SIZE;
+
+        // Splitting a range needs a new node, which can't be allocated with the lock held
+        Range* spare = (Range*)rangeCache.Allocate();
+
+        uint64_t flags = rangeLock.AcquireIRQ();
+
+        RBNode<Range>* node = freeRangesBySize.lowerBound([size](Range* range) { return range->size >= size; });
+        if (node == nullptr)
+            panic("Kernel range region exhausted allocating %lli pages!", numPages);
+
+        Range* range = node->value;
+        freeRangesBySize.remove(&range->sizeNode);
+
+        Range* ret;
+        if (range->size == size) {
+            freeRangesByAddress.remove(&range->addressNode);
+            ret = range;
+        } else {
+            ret = spare;
+            spare = nullptr;
+
+            ret->base = range->base;
+            ret->size = size;
+
+            // Taking from the front keeps its place in the address tree
+            range->base += size;
+            range->size -= size;
+            freeRangesBySize.insert(&range->sizeNode, range);
+        }
+
+        allocatedRanges.insert(&ret->addressNode, ret);
+
+        rangeLock.ReleaseIRQ(flags);
+
+        if (spare != nullptr)
+            rangeCache.Free(spare);
+
+        AllocatePages((VirtualAddress)ret->base, numPages);
+
+        return (void*)ret->base;
+    }
+
+    void FreeKernelRange(void* ptr) {
+        uint64_t address = (uint64_t)ptr;
+
+        uint64_t flags = rangeLock.AcquireIRQ();
+
+        Range* range = FindAllocatedRange(address);
+        allocatedRanges.remove(&range->addressNode);
+
+        rangeLock.ReleaseIRQ(flags);
+
+        FreePages((VirtualAddress)range->base, range->size / PAGE_SIZE - 1);
+
+        // The range can only be handed out again once it is unmapped
+        Range* unused[2];
+        int numUnused = 0;
+
+        flags = rangeLock.AcquireIRQ();
+
+        RBNode<Range>* nextNode = freeRangesByAddress.lowerBound([address](Range* free) { return free->base > address; });
+        RBNode<Range>* prevNode = nextNode != nullptr ? freeRangesByAddress.prev(nextNode) : freeRangesByAddress.back();
+
+        if (nextNode != nullptr && range->base + range->size == nextNode->value->base) {
+            Range* next = nextNode->value;
+            freeRangesBySize.remove(&next->sizeNode);
+            freeRangesByAddress.remove(&next->addressNode);
+            range->size += next->size;
+            unused[numUnused++] = next;
+        }
+
+        if (prevNode != nullptr && prevNode->value->base + prevNode->value->size == range->base) {
+            Range* prev = prevNode->value;
+            freeRangesBySize.remove(&prev->sizeNode);
+            prev->size += range->size;
+            freeRangesBySize.insert(&prev->sizeNode, prev);
+            unused[numUnused++] = range;
+        } else {
+            freeRangesByAddress.insert(&range->addressNode, range);
+            freeRangesBySize.insert(&range->sizeNode, range);
+        }
+
+        rangeLock.ReleaseIRQ(flags);
+
+        for (int i = 0; i < numUnused; i++)
+            rangeCache.Free(unused[i]);
+    }
+
+    uint64_t GetKernelRangePages(void* ptr) {
+        uint64_t flags = rangeLock.AcquireIRQ();
+        uint64_t numPages = FindAllocatedRange((uint64_t)ptr)->size / PAGE_SIZE - 1;
+        rangeLock.ReleaseIRQ(flags);
+
+        return numPages;
+    }
+
+    bool ExtendKernelRange(void* ptr, uint64_t numPages) {
+        uint64_t size = (numPages + 1) * PAGE_SIZE;
+
+        uint64_t flags = rangeLock.AcquireIRQ();
+
+        Range* range = FindAllocatedRange((uint64_t)ptr);
+        uint64_t oldSize = range->size;
+        if (size <= oldSize) {
+            rangeLock.ReleaseIRQ(flags);
+            return true;
+        }
+
+        uint64_t end = range->base + range->size;
+        RBNode<Range>* nextNode = freeRangesByAddress.lowerBound([end](Range* free) { return free->base >= end; });
+        if (nextNode == nullptr || nextNode->value->base != end || nextNode->value->size < size - oldSize) {
+            rangeLock.ReleaseIRQ(flags);
+            return false;
+        }
+
+        Range* next = nextNode->value;
+        Range* unused = nullptr;
+        freeRangesBySize.remove(&next->sizeNode);
+        if (next->size == size - oldSize) {
+            freeRangesByAddress.remove(&next->addressNode);
+            unused = next;
+        } else {
+            next->base += size - oldSize;
+            next->size -= size - oldSize;
+            freeRangesBySize.insert(&next->sizeNode, next);
+        }
+
+        range->size = size;
+
+        rangeLock.ReleaseIRQ(flags);
+
+        if (unused != nullptr)
+            rangeCache.Free(unused);
+
+        // The old guard page becomes part of the range
+        AllocatePages((VirtualAddress)(range->base + oldSize - PAGE_SIZE), numPages - (oldSize / PAGE_SIZE - 1));
+
+        return true;
+    }
+}} // namespace Memory::Virtual
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include <process/control.h>
 #include <string.h>
 
+#include "heap.h"
+#include "physical.h"
 #include "virtual.h"
 
 template <class T> void PageTableBase<T>::SetEntry(int index, PhysicalAddress addr, bool write, bool supervisor) {
@@ -46,6 +48,8 @@ namespace Memory { namespace Virtual {
             // Meaning you can't use the first page of virtual memory. Hopefully you didn't need those 4 kilobytes
             if (cr2 < PAGE_SIZE)
                 panic("Null Pointer Exception at %#llx (Faulting Address: %#llx) (Error Code: %#x)", info.rip, cr2, info.errorCode);
+            else if (cr2 >= HEAP_SLAB_BASE && cr2 < KERNEL_RANGE_END)
+                panic("Access to unmapped kernel heap memory at %#llx (Faulting Address: %#llx)", info.rip, cr2);
             else {
                 if (currentPML4 != kernelPML4 || cr2 >= KERNEL_VMA)
                     Allocate((VirtualAddress)cr2, Physical::Allocate());
@@ -146,18 +150,124 @@ namespace Memory { namespace Virtual {
 
     void Allocate(VirtualAddress virt) { Allocate(virt, Physical::Allocate()); }
 
+    // Returns the page table covering virt, creating missing tables when create is set
+    // currentPML4Mutex must be held
+    PageTable* GetPageTable(VirtualAddress virt, bool create) {
+        int pml4Index, pdptIndex, pdIndex, ptIndex, offset;
+        VirtualToIndex(virt, pml4Index, pdptIndex, pdIndex, ptIndex, offset);
+
+        bool supervisor = (uint64_t)virt < KERNEL_VMA;
+        if ((currentPML4->entries[pml4Index] & PAGE_PRESENT) == 0) {
+            if (!create)
+                return nullptr;
+
+            currentPML4->SetEntry(pml4Index, Physical::Allocate(), true, supervisor);
+            memset(currentPML4->GetEntry(pml4Index), 0, PAGE_SIZE);
+        }
+        PDPT* pdpt = currentPML4->GetEntry(pml4Index);
+
+        if ((pdpt->entries[pdptIndex] & PAGE_PRESENT) == 0) {
+            if (!create)
+                return nullptr;
+
+            pdpt->SetEntry(pdptIndex, Physical::Allocate(), true, supervisor);
+            memset(pdpt->GetEntry(pdptIndex), 0, PAGE_SIZE);
+        }
+        PageDirectory* pd = pdpt->GetEntry(pdptIndex);
+
+        if ((pd->entries[pdIndex] & PAGE_PRESENT) == 0) {
+            if (!create)
+                return nullptr;
+
+            pd->SetEntry(pdIndex, Physical::Allocate(), true, supervisor);
+            memset(pd->GetEntry(pdIndex), 0, PAGE_SIZE);
+        }
+
+        return pd->GetEntry(pdIndex);
+    }
+
+    // Maps a run of pages taking the lock and walking the tables once per page table
+    void AllocatePages(VirtualAddress virt, uint64_t numPages) {
+        bool supervisor = (uint64_t)virt < KERNEL_VMA;
+        PageTable* pt = nullptr;
+
+        currentPML4Mutex->Lock();
+        for (uint64_t i = 0; i < numPages; i++) {
+            uint64_t addr = (uint64_t)virt + i * PAGE_SIZE;
+            int ptIndex = (addr >> 12) & 0x1FF;
+            if (pt == nullptr || ptIndex == 0)
+                pt = GetPageTable((VirtualAddress)addr, true);
+
+            // Back whole page tables with a contiguous block when one is free
+            if (ptIndex == 0 && numPages - i >= PAGES_PER_LARGE_PAGE) {
+                PhysicalAddress block = Physical::AllocateLarge();
+                if (block != 0) {
+                    for (uint64_t j = 0; j < PAGES_PER_LARGE_PAGE; j++) {
+                        if ((pt->entries[j] & PAGE_PRESENT) == 0)
+                            pt->SetEntry(j, block + j * PAGE_SIZE, true, supervisor);
+                        else
+                            Physical::Free(block + j * PAGE_SIZE);
+                    }
+
+                    i += PAGES_PER_LARGE_PAGE - 1;
+                    continue;
+                }
+            }
+
+            if ((pt->entries[ptIndex] & PAGE_PRESENT) == 0)
+                pt->SetEntry(ptIndex, Physical::Allocate(), true, supervisor);
+        }
+        currentPML4Mutex->Unlock();
+    }
+
+    void FreePages(VirtualAddress virt, uint64_t numPages) {
+        PageTable* pt = nullptr;
+
+        currentPML4Mutex->Lock();
+        for (uint64_t i = 0; i < numPages; i++) {
+            uint64_t addr = (uint64_t)virt + i * PAGE_SIZE;
+            int ptIndex = (addr >> 12) & 0x1FF;
+            if (i == 0 || ptIndex == 0)
+                pt = GetPageTable((VirtualAddress)addr, false);
+
+            if (pt == nullptr || (pt->entries[ptIndex] & PAGE_PRESENT) == 0)
+                continue;
+
+            Physical::Free(pt->entries[ptIndex] & ~(PAGE_SIZE - 1));
+            pt->ClearEntry(ptIndex);
+            InvalidatePage((VirtualAddress)addr);
+        }
+        currentPML4Mutex->Unlock();
+    }
+
+    PhysicalAddress GetPhysicalAddress(VirtualAddress virt) {
+        currentPML4Mutex->Lock();
+        PageTable* pt = GetPageTable(virt, false);
+        int ptIndex = ((uint64_t)virt >> 12) & 0x1FF;
+
+        PhysicalAddress phys = 0;
+        if (pt != nullptr && (pt->entries[ptIndex] & PAGE_PRESENT))
+            phys = (pt->entries[ptIndex] & ~(PAGE_SIZE - 1)) | ((uint64_t)virt & (PAGE_SIZE - 1));
+        currentPML4Mutex->Unlock();
+
+        return phys;
+    }
+
     void Free(VirtualAddress virt) {
         int pml4Index, pdptIndex, pdIndex, ptIndex, offset;
         VirtualToIndex(virt, pml4Index, pdptIndex, pdIndex, ptIndex, offset);
         currentPML4Mutex->Lock();
-        if (currentPML4->entries[pml4Index] != 0) {
+        if (currentPML4->entries[pml4Index] & PAGE_PRESENT) {
             PDPT* pdpt = currentPML4->GetEntry(pml4Index);
-            if (pdpt->entries[pdptIndex] != 0) {
-                PageDirectory* pd = pdpt->GetEntry(pdIndex);
-                if (pd->entries[ptIndex] != 0) {
-                    PageTable* pt = pd->GetEntry(ptIndex);
-                    Physical::Free(pt->entries[ptIndex] & 0xFFFFFFFFFFFFF000);
-                    pt->ClearEntry(ptIndex);
+            if (pdpt->entries[pdptIndex] & PAGE_PRESENT) {
+                PageDirectory* pd = pdpt->GetEntry(pdptIndex);
+                if (pd->entries[pdIndex] & PAGE_PRESENT) {
+                    PageTable* pt = pd->GetEntry(pdIndex);
+                    if (pt->entries[ptIndex] & PAGE_PRESENT) {
+                        Physical::Free(pt->entries[ptIndex] & ~(PAGE_SIZE - 1));
+                        pt->ClearEntry(ptIndex);
+                        InvalidatePage(virt);
+                    }
                 }
             }
         }
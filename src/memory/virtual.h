@@ -6,6 +6,10 @@
 #define PAGE_WRITE (1 << 1)
 #define PAGE_SUPERVISOR (1 << 2)
 
+// Page granular kernel allocations, each range is followed by an unmapped guard page
+#define KERNEL_RANGE_BASE (KERNEL_VMA + 0x180000000000)
+#define KERNEL_RANGE_END (KERNEL_VMA + 0x200000000000)
+
 template <class T> struct PageTableBase {
     uint64_t entries[512];
 
@@ -20,4 +24,9 @@ typedef PageTableBase<PageDirectory*> PDPT;
 typedef PageTableBase<PDPT*> PML4;
 
 extern "C" void SetCurrentPML4(PhysicalAddress pml4);
-extern "C" uint64_t GetCR2();
\ No newline at end of file
+extern "C" uint64_t GetCR2();
+extern "C" PhysicalAddress GetCR3();
+
+namespace Memory { namespace Virtual {
+    void InitKernelRanges();
+}} // namespace Memory::Virtual
\ No newline at end of file
@@ -5,36 +5,200 @@
 #include <process/control.h>
 #include <process/process.h>
 
-Mutex::Mutex() { owner = nullptr; }
+// Guards every process's priorities and blockedOn, and every mutex's inheritance state
+// Taken inside a mutex's own lock, so the chain can be followed without taking the others
+Spinlock priorityLock("mutex priority");
+
+#ifdef LOCK_STATS
+Mutex::Mutex(const char* name) : owner(0), stats{0, 0, 0}, waiterPriority(0), lockStats(name) {}
+#else
+Mutex::Mutex(const char* name) : owner(0), stats{0, 0, 0}, waiterPriority(0) {}
+#endif
 
 void Mutex::Lock() {
     if (currentProcess == nullptr)
         return;
 
-    if (CompareExchange(&owner, 0, (uint64_t)currentProcess))
+#ifdef LOCK_STATS
+    uint64_t start = ReadTSC();
+#endif
+
+    if (CompareExchange(&owner, 0, (uint64_t)currentProcess)) {
+        stats.uncontended++;
+#ifdef LOCK_STATS
+        lockStats.Acquired(start, false);
+#endif
         return;
+    }
+
+    // An owner running on another processor will likely release soon, so spin instead of paying for a switch
+    // The owner may also have let go since the first attempt, which doesn't count as spinning
+    bool spun = false;
+    for (uint64_t i = 0; i < MUTEX_SPIN_LIMIT; i++) {
+        uint64_t currentOwner = owner;
+        if (currentOwner == 0) {
+            if (CompareExchange(&owner, 0, (uint64_t)currentProcess)) {
+                if (spun)
+                    stats.spun++;
+                else
+                    stats.uncontended++;
+#ifdef LOCK_STATS
+                lockStats.Acquired(start, true);
+#endif
+                return;
+            }
+
+            continue;
+        }
+
+        Process* ownerProcess = (Process*)(currentOwner & ~(uint64_t)MUTEX_WAITERS);
+        if (ownerProcess == currentProcess || !ownerProcess->running)
+            break;
+
+        spun = true;
+        asm volatile("pause" : : : "memory");
+    }
+
+    // Flag the owner word under the lock, so the owner's Unlock has to look at the wait queue
+    uint64_t flags = lock.AcquireIRQ();
+    while (true) {
+        uint64_t currentOwner = owner;
+        if (currentOwner == 0) {
+            if (CompareExchange(&owner, 0, (uint64_t)currentProcess)) {
+                if (spun)
+                    stats.spun++;
+                else
+                    stats.uncontended++;
+#ifdef LOCK_STATS
+                lockStats.Acquired(start, true);
+#endif
+                lock.ReleaseIRQ(flags);
+                return;
+            }
+        } else if ((currentOwner & MUTEX_WAITERS) || CompareExchange(&owner, currentOwner, currentOwner | MUTEX_WAITERS))
+            break;
+    }
+
+    // Lend this process's priority to the owner, and on down the chain of mutexes the owner is blocked on
+    priorityLock.Acquire();
+    if (!waiters.HasWaiters()) {
+        waiterPriority = currentProcess->priority;
+        GetOwner()->heldMutexes.push(this, &heldNode);
+    } else if (currentProcess->priority > waiterPriority)
+        waiterPriority = currentProcess->priority;
 
-    // Sleep
-    waitlist.push(currentProcess);
-    Yield();
+    currentProcess->blockedOn = this;
+    Boost(GetOwner(), currentProcess->priority);
+    priorityLock.Release();
+
+    // Unlock hands the mutex over before waking this process
+    waiters.Sleep(lock, flags);
+    stats.slept++;
+#ifdef LOCK_STATS
+    lockStats.Acquired(start, true);
+#endif
 }
 
 void Mutex::Unlock() {
-    if (currentProcess == nullptr || owner == nullptr)
+    if (currentProcess == nullptr || owner == 0)
         return;
 
-    if (owner == currentProcess) {
-        if (waitlist.front() == nullptr)
-            owner = nullptr;
-        else {
-            Process* nextOwner = waitlist.front();
-            waitlist.pop();
-
-            QueueExecution(nextOwner);
-            owner = nextOwner;
-        }
-    } else
+    if ((Process*)(owner & ~(uint64_t)MUTEX_WAITERS) != currentProcess)
         panic("Attempting to unlock mutex owned by another process!");
+
+#ifdef LOCK_STATS
+    lockStats.Released();
+#endif
+
+    if (CompareExchange(&owner, (uint64_t)currentProcess, 0))
+        return;
+
+    // Hand ownership directly to the highest priority waiter, so nothing can take the mutex before it runs
+    // Waiters of equal priority are served in arrival order
+    uint64_t flags = lock.AcquireIRQ();
+    priorityLock.Acquire();
+
+    uint64_t highest = 0;
+    waiters.ForEach([&highest](Process* process) {
+        if (process->priority > highest)
+            highest = process->priority;
+    });
+
+    Process* nextOwner = waiters.DequeueIf([highest](Process* process) { return process->priority == highest; });
+    nextOwner->blockedOn = nullptr;
+    currentProcess->heldMutexes.remove(&heldNode);
+
+    owner = (uint64_t)nextOwner | (waiters.HasWaiters() ? MUTEX_WAITERS : 0);
+    if (waiters.HasWaiters()) {
+        waiterPriority = 0;
+        waiters.ForEach([this](Process* process) {
+            if (process->priority > waiterPriority)
+                waiterPriority = process->priority;
+        });
+
+        // The new owner is runnable, so there is no chain to follow
+        nextOwner->heldMutexes.push(this, &heldNode);
+        if (nextOwner->priority < waiterPriority)
+            nextOwner->priority = waiterPriority;
+    }
+
+    RestorePriority(currentProcess);
+    priorityLock.Release();
+
+    QueueExecution(nextOwner);
+    lock.ReleaseIRQ(flags);
 }
 
-Process* Mutex::GetOwner() { return owner; }
\ No newline at end of file
+Process* Mutex::GetOwner() { return (Process*)(owner & ~(uint64_t)MUTEX_WAITERS); }
+MutexStats Mutex::GetStats() { return stats; }
+
+void Mutex::SetPriority(Process* process, uint64_t priority) {
+    if (priority > PROCESS_MAXIMUM_PRIORITY)
+        priority = PROCESS_MAXIMUM_PRIORITY;
+
+    uint64_t flags = priorityLock.AcquireIRQ();
+    process->basePriority = priority;
+    RestorePriority(process);
+
+    Mutex* mutex = process->blockedOn;
+    if (mutex != nullptr) {
+        if (mutex->waiterPriority < process->priority)
+            mutex->waiterPriority = process->priority;
+
+        Boost(mutex->GetOwner(), process->priority);
+    }
+    priorityLock.ReleaseIRQ(flags);
+}
+
+// Must be called holding priorityLock with interrupts disabled
+void Mutex::Boost(Process* owner, uint64_t priority) {
+    // Priorities only rise along the way, so a deadlocked cycle still ends
+    while (owner != nullptr && owner->priority < priority) {
+        owner->priority = priority;
+        PriorityChanged(owner);
+
+        Mutex* mutex = owner->blockedOn;
+        if (mutex == nullptr)
+            return;
+
+        if (mutex->waiterPriority < priority)
+            mutex->waiterPriority = priority;
+
+        owner = mutex->GetOwner();
+    }
+}
+
+// Must be called holding priorityLock with interrupts disabled
+void Mutex::RestorePriority(Process* process) {
+    uint64_t priority = process->basePriority;
+    if (process->heldMutexes.front() != nullptr) {
+        List<Mutex>::Iterator iter(&process->heldMutexes);
+        do {
+            if (iter.value->waiterPriority > priority)
+                priority = iter.value->waiterPriority;
+        } while (iter.Next());
+    }
+
+    process->priority = priority;
+    PriorityChanged(process);
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <objectcache.h>
+
+#include <interrupt/irq.h>
+#include <memory/defs.h>
+#include <memory/heap.h>
+#include <panic.h>
+#include <queue.h>
+
+ObjectCacheBase queueNodeCache(3 * sizeof(void*));
+
+// The lock is taken with interrupts disabled, growing drops it first as the heap may sleep
+void* ObjectCacheBase::Allocate() {
+    uint64_t flags = lock.AcquireIRQ();
+
+    while (freeList == nullptr) {
+        lock.ReleaseIRQ(flags);
+
+        Grow();
+
+        flags = lock.AcquireIRQ();
+    }
+
+    void* ptr = freeList;
+    freeList = *(void**)ptr;
+
+    stats.allocations++;
+    stats.inUse++;
+    if (stats.inUse > stats.maximumInUse)
+        stats.maximumInUse = stats.inUse;
+
+    lock.ReleaseIRQ(flags);
+
+    return ptr;
+}
+
+void* ObjectCacheBase::Allocate(size_t size) {
+    if (size != stats.objectSize)
+        panic("Object cache for %lli byte objects asked for %lli bytes!", stats.objectSize, size);
+
+    return Allocate();
+}
+
+void ObjectCacheBase::Free(void* ptr) {
+    if (ptr == nullptr)
+        return;
+
+    uint64_t flags = lock.AcquireIRQ();
+
+    *(void**)ptr = freeList;
+    freeList = ptr;
+
+    stats.frees++;
+    stats.inUse--;
+
+    lock.ReleaseIRQ(flags);
+}
+
+ObjectCacheStats ObjectCacheBase::GetStats() {
+    uint64_t flags = lock.AcquireIRQ();
+    ObjectCacheStats ret = stats;
+    lock.ReleaseIRQ(flags);
+
+    return ret;
+}
+
+// Called without the lock held as the heap may need to map pages
+void ObjectCacheBase::Grow() {
+    uint64_t chunkSize = slotSize * 8 > PAGE_SIZE ? slotSize * 8 : PAGE_SIZE;
+    uint8_t* chunk = (uint8_t*)Memory::Heap::AllocateAligned(chunkSize, CACHE_LINE_SIZE);
+
+    // Thread the slots together first so the lock is only held to splice them in
+    uint64_t numSlots = chunkSize / slotSize;
+    for (uint64_t i = 0; i < numSlots - 1; i++)
+        *(void**)(chunk + i * slotSize) = chunk + (i + 1) * slotSize;
+
+    uint64_t flags = lock.AcquireIRQ();
+
+    *(void**)(chunk + (numSlots - 1) * slotSize) = freeList;
+    freeList = chunk;
+    stats.chunks++;
+
+    lock.ReleaseIRQ(flags);
+}
\ No newline at end of file
@@ -4,24 +4,46 @@
 
 #include <console.h>
 #include <fs.h>
+#include <interrupt/irq.h>
 #include <interrupt/stack.h>
+#include <list.h>
 #include <memory/virtual.h>
-#include <pair.h>
+#include <mpscqueue.h>
+#include <panic.h>
+#include <preempt.h>
 #include <process/process.h>
 #include <queue.h>
+#include <rcu.h>
 #include <string.h>
 
 Process kernelProcess("System");
 
 Process* currentProcess = nullptr;
 
-Queue<Process> processHash[PROCESS_HASH_SIZE];
-Mutex processHashMutex;
+HashMap<uint64_t, Process*> processHash;
+RWLock processHashLock("process table");
 
-Queue<Process> runningQueue;
+// Only touched with interrupts disabled
+// One list per priority, a bit is set in runnablePriorities while its list isn't empty
+// A runnable higher priority always goes first, so lower priorities starve while one is busy
+List<Process> runQueues[PROCESS_MAXIMUM_PRIORITY + 1];
+uint32_t runnablePriorities = 0;
+bool idle = false;
 
-Queue<Pair<uint64_t, uint64_t>> zombie;
-Mutex zombieMutex;
+volatile uint64_t preemptCount = 0;
+volatile bool preemptPending = false;
+
+// Filled from any context, drained by the scheduler into the run queue
+MPSCQueue<Process> wakeupQueue;
+MPSCQueue<DeferredWork> deferredQueue;
+
+// Exited processes, linked through their wakeup node as nothing can wake them any more
+// They are still on their own stack until the switch, so they are freed later by whoever reaps next
+MPSCQueue<Process> deadQueue;
+
+// Exit status of processes that exited without anyone waiting, by id
+HashMap<uint64_t, uint64_t> zombies;
+Mutex zombieMutex("zombies");
 
 extern "C" uint64_t ProperFork(Process* child);
 extern "C" void TaskSwitch(Process* newProcess);
@@ -33,43 +55,137 @@ extern "C" void FloatSave(void* ptr);
 
 uint64_t test = 0;
 
-void Preempt() {
-    if (currentProcess == nullptr)
+// Must be called with interrupts disabled
+static void PushRunnable(Process* process) {
+    process->runPriority = process->priority;
+    runQueues[process->runPriority].push(process, &process->queueNode);
+    runnablePriorities |= (uint32_t)1 << process->runPriority;
+}
+
+// Must be called with interrupts disabled
+static void RemoveRunnable(Process* process) {
+    List<Process>& queue = runQueues[process->runPriority];
+    queue.remove(&process->queueNode);
+    if (queue.front() == nullptr)
+        runnablePriorities &= ~((uint32_t)1 << process->runPriority);
+
+    process->runPriority = PROCESS_NOT_RUNNABLE;
+}
+
+void PriorityChanged(Process* process) {
+    if (process->runPriority == PROCESS_NOT_RUNNABLE || process->runPriority == process->priority)
         return;
 
-    if (currentProcess->state == Process::State::UNINTERRUPTABLE)
+    RemoveRunnable(process);
+    PushRunnable(process);
+}
+
+// Must be called with interrupts disabled
+static void DrainQueues() {
+    RCU::QuiescentState();
+
+    for (DeferredWork* work = deferredQueue.pop(); work != nullptr; work = deferredQueue.pop()) {
+        work->queued = 0;
+        work->function(work->context);
+    }
+
+    for (Process* process = wakeupQueue.pop(); process != nullptr; process = wakeupQueue.pop())
+        PushRunnable(process);
+}
+
+// Must be called with interrupts disabled, halts until a process becomes runnable
+static Process* NextProcess() {
+    DrainQueues();
+    while (runnablePriorities == 0) {
+        idle = true;
+        asm volatile("sti; hlt; cli" : : : "memory");
+        DrainQueues();
+    }
+    idle = false;
+
+    // Highest priority first, each list keeps arrival order among equals
+    Process* process = runQueues[31 - __builtin_clz(runnablePriorities)].front();
+    RemoveRunnable(process);
+    return process;
+}
+
+void Preempt() {
+    if (currentProcess == nullptr || idle)
         return;
 
-    if (runningQueue.front() == nullptr)
+    // Whoever holds preemption off takes it when they re-enable it
+    if (preemptCount != 0) {
+        preemptPending = true;
         return;
+    }
+    preemptPending = false;
 
-    QueueExecution(currentProcess);
+    DrainQueues();
+    if (runnablePriorities == 0)
+        return;
 
-    asm volatile("sti");
+    PushRunnable(currentProcess);
 
     Yield();
 }
 
+void PreemptDeferred() {
+    uint64_t flags = Interrupt::Disable();
+
+    // With interrupts disabled the timer can't have been taken yet either, it will arrive once they are restored
+    if (flags & (1 << 9))
+        Preempt();
+
+    Interrupt::Restore(flags);
+}
+
 void Yield() {
-    Process* newProcess = runningQueue.front();
+    if (preemptCount != 0)
+        panic("Attempting to switch processes with preemption disabled!");
 
-    while (newProcess == nullptr)
-        newProcess = runningQueue.front();
+    uint64_t flags = Interrupt::Disable();
 
-    runningQueue.pop();
+    Process* newProcess = NextProcess();
 
     FloatSave(currentProcess->floatingPoint);
     FloatLoad(newProcess->floatingPoint);
 
-    Memory::Virtual::SetCurrentAddressSpace(newProcess->pagingStructure, &newProcess->pagingStructureMutex);
+    Memory::Virtual::SetCurrentAddressSpace(newProcess->addressSpace, newProcess->addressSpaceMutex);
     Interrupt::SetInterruptStack((uint64_t)newProcess->stack);
 
+    currentProcess->running = false;
+    newProcess->running = true;
     TaskSwitch(newProcess);
+
+    Interrupt::Restore(flags);
+}
+
+void ReapProcesses() {
+    while (true) {
+        // Interrupts keep the consumers to one at a time
+        uint64_t flags = Interrupt::Disable();
+        Process* process = deadQueue.pop();
+        Interrupt::Restore(flags);
+
+        if (process == nullptr)
+            return;
+
+        delete process;
+    }
 }
 
-void QueueExecution(Process* process) { runningQueue.push(process); }
+void QueueExecution(Process* process) { wakeupQueue.push(process, &process->wakeupNode); }
+
+void Defer(DeferredWork* work) {
+    if (CompareExchange(&work->queued, 0, 1))
+        deferredQueue.push(work, &work->node);
+}
 
 uint64_t Execute(const char* filepath, const char** args, const char** env) {
+    ReapProcesses();
+
+    ArenaScope scope(&currentProcess->arena);
+
     // Open the file
     int fd = Open(filepath, OPEN_READ);
     if (fd < 0)
@@ -91,9 +207,10 @@ uint64_t Execute(const char* filepath, const char** args, const char** env) {
     // Create a new process
     Process* newProcess = new Process(lastSlash);
 
-    // Switch to the new process address space
-    currentProcess->state = Process::State::UNINTERRUPTABLE;
-    Memory::Virtual::SetCurrentAddressSpace(newProcess->pagingStructure, &newProcess->pagingStructureMutex);
+    // Borrow the new process's address space, Yield switches back to it if loading sleeps
+    currentProcess->addressSpace = newProcess->pagingStructure;
+    currentProcess->addressSpaceMutex = &newProcess->pagingStructureMutex;
+    Memory::Virtual::SetCurrentAddressSpace(currentProcess->addressSpace, currentProcess->addressSpaceMutex);
 
     // Load the file into the new address space
     uint64_t entry = LoadELFExecutable(fd);
@@ -101,7 +218,9 @@ uint64_t Execute(const char* filepath, const char** args, const char** env) {
     Close(fd);
 
     if (entry >= KERNEL_VMA) {
-        currentProcess->state = Process::State::NORMAL;
+        currentProcess->addressSpace = currentProcess->pagingStructure;
+        currentProcess->addressSpaceMutex = &currentProcess->pagingStructureMutex;
+        Memory::Virtual::SetCurrentAddressSpace(currentProcess->addressSpace, currentProcess->addressSpaceMutex);
         return 0;
     }
 
@@ -117,7 +236,7 @@ uint64_t Execute(const char* filepath, const char** args, const char** env) {
     char* stackBottom = (char*)0x7FFFFFFFFFFF;
 
     // Copy arguments into user space
-    const char** argvUser = new const char*[argc];
+    const char** argvUser = scope.Allocate<const char*>(argc);
     for (int i = 0; i < argc; i++) {
         stackBottom -= strlen(args[i]) + 1;
         strcpy(stackBottom, args[i]);
@@ -133,7 +252,7 @@ uint64_t Execute(const char* filepath, const char** args, const char** env) {
     }
 
     // Copy environment variables into user space
-    const char** envpUser = new const char*[envc];
+    const char** envpUser = scope.Allocate<const char*>(envc);
     for (int i = 0; i < envc; i++) {
         stackBottom -= strlen(env[i]) + 1;
         strcpy(stackBottom, env[i]);
@@ -153,8 +272,6 @@ uint64_t Execute(const char* filepath, const char** args, const char** env) {
     *argv = nullptr;
     argv -= argc;
 
-    delete argvUser;
-
     // Fill envp
     const char** envp = argv;
     envp -= envc + 1;
@@ -165,100 +282,102 @@ uint64_t Execute(const char* filepath, const char** args, const char** env) {
     *envp = nullptr;
     envp -= envc;
 
-    delete envpUser;
-
     // Align stack pointer
     stackBottom = (char*)((uint64_t)envp & 0x7FFFFFFFFFF0);
 
+    // The child may have exited and been reaped by the time this process runs again
+    uint64_t id = newProcess->id;
+
     // Switch process and entry
+    uint64_t flags = Interrupt::Disable();
     QueueExecution(currentProcess);
     FloatSave(currentProcess->floatingPoint);
 
-    asm volatile("cli");
-    currentProcess->state = Process::State::NORMAL;
+    // This process switches back to its own address space when it next runs
+    currentProcess->addressSpace = currentProcess->pagingStructure;
+    currentProcess->addressSpaceMutex = &currentProcess->pagingStructureMutex;
     Interrupt::SetInterruptStack((uint64_t)newProcess->stack);
+    currentProcess->running = false;
+    newProcess->running = true;
     TaskEnter(newProcess, entry, stackBottom, argc, argv, envp);
-    return newProcess->id;
+    Interrupt::Restore(flags);
+    return id;
 }
 
 uint64_t Wait(uint64_t pid) {
     if (pid == currentProcess->id)
         return 0xFFFFFFFFFFFFFFFF;
 
-    // Locate process
-    uint64_t idx = pid % PROCESS_HASH_SIZE;
-
-    bool found = false;
-
-    processHashMutex.Lock();
-    if (processHash[idx].front() == nullptr) {
-        processHashMutex.Unlock();
+    // Locate process, Exit can't run between the lookup and joining its exit queue
+    processHashLock.LockShared();
+    Process** process = processHash.find(pid);
+    if (process == nullptr) {
         zombieMutex.Lock();
-        if (zombie.front() == nullptr) {
+        uint64_t* status = zombies.find(pid);
+        if (status == nullptr) {
             zombieMutex.Unlock();
+            processHashLock.UnlockShared();
             return 0xFFFFFFFFFFFFFFFF;
         }
 
-        Queue<Pair<uint64_t, uint64_t>>::Iterator iter(&zombie);
-        do {
-            if (iter.value->key == pid) {
-                zombieMutex.Unlock();
-                uint64_t ret = iter.value->value;
-                iter.Remove();
-                return ret;
-            }
-        } while (iter.Next());
-
+        uint64_t ret = *status;
+        zombies.remove(pid);
         zombieMutex.Unlock();
-        return 0xFFFFFFFFFFFFFFFF;
+        processHashLock.UnlockShared();
+        return ret;
     }
 
-    Queue<Process>::Iterator iter(&processHash[idx]);
-    do {
-        if (iter.value->id == pid) {
-            found = true;
-            iter.value->exit.push(currentProcess);
-            break;
-        }
-    } while (iter.Next());
-
-    processHashMutex.Unlock();
-
-    if (!found)
-        return 0xFFFFFFFFFFFFFFFF;
-
-    Yield();
+    Process* target = *process;
+    uint64_t flags = target->exitLock.AcquireIRQ();
+    processHashLock.UnlockShared();
+    target->exit.Sleep(target->exitLock, flags);
+    ReapProcesses();
 
     return currentProcess->queueData;
 }
 
 void Exit(uint64_t status) {
+    if (preemptCount != 0)
+        panic("Attempting to exit with preemption disabled!");
+
+    ReapProcesses();
+
+    // Leave the hashmap while holding it, so no waiter can arrive after the exit queue is drained
+    processHashLock.Lock();
+    processHash.remove(currentProcess->id);
+
     // Awaken exit queue
-    if (currentProcess->exit.front() != nullptr) {
-        for (Process* proc = currentProcess->exit.front(); proc != nullptr; proc = currentProcess->exit.front()) {
-            proc->queueData = status & 0xFF;
-            QueueExecution(proc);
-            currentProcess->exit.pop();
-        }
-    } else
-        zombie.push(new Pair<uint64_t, uint64_t>(currentProcess->id, status & 0xFF));
+    uint64_t flags = currentProcess->exitLock.AcquireIRQ();
+    bool waited = currentProcess->exit.HasWaiters();
+    for (Process* proc = currentProcess->exit.Dequeue(); proc != nullptr; proc = currentProcess->exit.Dequeue()) {
+        proc->queueData = status & 0xFF;
+        QueueExecution(proc);
+    }
+    currentProcess->exitLock.ReleaseIRQ(flags);
+
+    if (!waited) {
+        zombieMutex.Lock();
+        zombies.insert(currentProcess->id, status & 0xFF);
+        zombieMutex.Unlock();
+    }
+    processHashLock.Unlock();
+
+    Interrupt::Disable();
 
     // Exit
     register Process* oldProcess = currentProcess;
 
-    currentProcess = runningQueue.front();
-    while (currentProcess == nullptr)
-        runningQueue.front();
-
-    runningQueue.pop();
+    currentProcess = NextProcess();
+    currentProcess->running = true;
 
     FloatLoad(currentProcess->floatingPoint);
 
-    Memory::Virtual::SetCurrentAddressSpace(currentProcess->pagingStructure, &currentProcess->pagingStructureMutex);
+    Memory::Virtual::SetCurrentAddressSpace(currentProcess->addressSpace, currentProcess->addressSpaceMutex);
 
-    SetStackPointer(currentProcess->kernelStackPointer);
+    // Interrupts stay disabled until the switch, so nothing can reap it while its stack is still in use
+    deadQueue.push(oldProcess, &oldProcess->wakeupNode);
 
-    delete oldProcess;
+    SetStackPointer(currentProcess->kernelStackPointer);
 
     TaskExit();
 }
@@ -1,12 +1,16 @@
 #include "elf.h"
 
 #include <fs.h>
+#include <process/process.h>
 #include <string.h>
 
 bool VerifyELFExecutable(int fd) {
-    Elf64_Ehdr* header = new Elf64_Ehdr;
+    ArenaScope scope(&currentProcess->arena);
+
+    Elf64_Ehdr* header = scope.Allocate<Elf64_Ehdr>(1);
     Seek(fd, 0, SEEK_SET);
-    Read(fd, header, sizeof(Elf64_Ehdr));
+    if (Read(fd, header, sizeof(Elf64_Ehdr)) < 0)
+        return false;
 
     bool ret = true;
 
@@ -34,45 +38,33 @@ bool VerifyELFExecutable(int fd) {
     else if (header->version < EV_CURRENT)
         ret = false;
 
-    delete header;
     return ret;
 }
 
 uint64_t LoadELFExecutable(int fd) {
-    Elf64_Ehdr* elfHeader = new Elf64_Ehdr;
+    ArenaScope scope(&currentProcess->arena);
+
+    Elf64_Ehdr* elfHeader = scope.Allocate<Elf64_Ehdr>(1);
     Seek(fd, 0, SEEK_SET);
-    if (Read(fd, elfHeader, sizeof(Elf64_Ehdr)) < 0) {
-        delete elfHeader;
+    if (Read(fd, elfHeader, sizeof(Elf64_Ehdr)) < 0)
         return ~0;
-    }
 
-    uint8_t* programHeaders = new uint8_t[elfHeader->phNum * elfHeader->phEntSize];
+    uint8_t* programHeaders = scope.Allocate<uint8_t>(elfHeader->phNum * elfHeader->phEntSize);
     Seek(fd, elfHeader->phOff, SEEK_SET);
-    if (Read(fd, programHeaders, elfHeader->phNum * elfHeader->phEntSize) < 0) {
-        delete elfHeader;
-        delete programHeaders;
+    if (Read(fd, programHeaders, elfHeader->phNum * elfHeader->phEntSize) < 0)
         return ~0;
-    }
 
     Elf64_Phdr* pHdr = (Elf64_Phdr*)programHeaders;
     for (int i = 0; i < elfHeader->phNum; i++) {
         if (pHdr->type == PT_LOAD) {
             Seek(fd, pHdr->offset, SEEK_SET);
-            if (Read(fd, (void*)pHdr->vAddr, pHdr->fileSz) < 0) {
-                delete elfHeader;
-                delete programHeaders;
+            if (Read(fd, (void*)pHdr->vAddr, pHdr->fileSz) < 0)
                 return ~0;
-            }
             memset((void*)(pHdr->vAddr + pHdr->fileSz), 0, pHdr->memSz - pHdr->fileSz);
         }
 
         pHdr = (Elf64_Phdr*)((uint64_t)pHdr + elfHeader->phEntSize);
     }
 
-    uint64_t entry = elfHeader->entry;
-
-    delete elfHeader;
-    delete programHeaders;
-
-    return entry;
+    return elfHeader->entry;
 }
\ No newline at end of file
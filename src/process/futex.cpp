@@ -0,0 +1,102 @@
+#include <process/futex.h>
+
+#include <atomic.h>
+#include <errno.h>
+#include <hashmap.h>
+#include <memory/virtual.h>
+#include <process/process.h>
+#include <spinlock.h>
+#include <waitqueue.h>
+
+struct FutexBucket {
+    Spinlock lock;
+    WaitQueue waiters;
+};
+
+// Keyed by physical address, so the same word mapped in different processes shares a queue
+FutexBucket futexBuckets[FUTEX_HASH_SIZE];
+
+// Bumped whenever compaction moves a page
+Atomic<uint64_t> futexGeneration;
+
+static bool IsValidFutex(uint32_t* address) { return address != nullptr && (uint64_t)address < KERNEL_VMA && ((uint64_t)address & (sizeof(uint32_t) - 1)) == 0; }
+
+uint64_t FutexWait(uint32_t* address, uint32_t expected, time_t timeout) {
+    if (!IsValidFutex(address))
+        return ERROR_BAD_PARAMETER;
+
+    // Touch the word first so it is mapped before translating it
+    if (*(volatile uint32_t*)address != expected)
+        return ERROR_VALUE_CHANGED;
+
+    PhysicalAddress key;
+    FutexBucket* bucket;
+    uint64_t flags;
+    while (true) {
+        uint64_t generation = futexGeneration.load(MemoryOrder::ACQUIRE);
+        key = Memory::Virtual::GetPhysicalAddress(address);
+        bucket = &futexBuckets[HashKey(key) % FUTEX_HASH_SIZE];
+
+        // Pages only move with interrupts disabled, so the key holds for as long as the bucket lock does
+        flags = bucket->lock.AcquireIRQ();
+        if (futexGeneration.load(MemoryOrder::RELAXED) == generation)
+            break;
+
+        bucket->lock.ReleaseIRQ(flags);
+    }
+
+    // A waker has to take the bucket lock, so checking again under it can't miss a wakeup
+    if (*(volatile uint32_t*)address != expected) {
+        bucket->lock.ReleaseIRQ(flags);
+        return ERROR_VALUE_CHANGED;
+    }
+
+    currentProcess->wait.key = key;
+    if (timeout == 0) {
+        bucket->waiters.Sleep(bucket->lock, flags);
+        return SUCCESS;
+    }
+
+    return bucket->waiters.Sleep(bucket->lock, flags, timeout) ? SUCCESS : ERROR_TIMEOUT;
+}
+
+uint64_t FutexWake(uint32_t* address, uint64_t count) {
+    if (!IsValidFutex(address))
+        return 0;
+
+    PhysicalAddress key = Memory::Virtual::GetPhysicalAddress(address);
+    if (key == 0)
+        return 0;
+
+    FutexBucket* bucket = &futexBuckets[HashKey(key) % FUTEX_HASH_SIZE];
+
+    uint64_t woken = 0;
+    uint64_t flags = bucket->lock.AcquireIRQ();
+    while (woken < count) {
+        Process* process = bucket->waiters.DequeueIf([key](Process* waiter) { return waiter->wait.key == key; });
+        if (process == nullptr)
+            break;
+
+        QueueExecution(process);
+        woken++;
+    }
+    bucket->lock.ReleaseIRQ(flags);
+
+    return woken;
+}
+
+bool FutexPageHasWaiters(PhysicalAddress page) {
+    bool found = false;
+    for (uint64_t i = 0; i < FUTEX_HASH_SIZE && !found; i++) {
+        futexBuckets[i].lock.Acquire();
+        futexBuckets[i].waiters.ForEach([page, &found](Process* waiter) {
+            if (waiter->wait.key >= page && waiter->wait.key < page + PAGE_SIZE)
+                found = true;
+        });
+        futexBuckets[i].lock.Release();
+    }
+
+    return found;
+}
+
+void FutexPageMoved() { futexGeneration.fetch_add(1, MemoryOrder::RELEASE); }
\ No newline at end of file
@@ -9,11 +9,19 @@
 
 uint64_t nextID = 1;
 
+ObjectCache<Process> processCache;
+
 extern "C" uint64_t stackTop;
 
 Process::Process(const char* name) {
-    // Set state
-    state = State::NORMAL;
+    running = false;
+    rcuNesting = 0;
+    basePriority = currentProcess != nullptr ? currentProcess->basePriority : PROCESS_DEFAULT_PRIORITY;
+    priority = basePriority;
+    runPriority = PROCESS_NOT_RUNNABLE;
+    blockedOn = nullptr;
+    wait.queue = nullptr;
+    wait.timerQueued = false;
 
     // Select next ID
     id = nextID;
@@ -23,13 +31,6 @@ Process::Process(const char* name) {
     this->name = new char[strlen(name) + 1];
     strcpy(this->name, name);
 
-    // Setup descriptors
-    devices = nullptr;
-    devicesLength = 0;
-
-    files = nullptr;
-    filesLength = 0;
-
     // Allocate floating point storage
     floatingPoint = Memory::Heap::AllocateAligned(512, 16);
 
@@ -44,30 +45,27 @@ Process::Process(const char* name) {
         memset((void*)((uint64_t)stack - KERNEL_STACK_SIZE), 0, KERNEL_STACK_SIZE);
 
         // Insert into hashmap
-        int hashIdx = id % PROCESS_HASH_SIZE;
-
-        processHashMutex.Lock();
-        processHash[hashIdx].push(this);
-        processHashMutex.Unlock();
+        processHashLock.Lock();
+        processHash.insert(id, this);
+        processHashLock.Unlock();
 
         // Clone descriptors
-        devicesLength = currentProcess->devicesLength;
-        if (devicesLength > 0) {
-            devices = new Device::Device*[devicesLength];
-            for (uint64_t i = 0; i < devicesLength; i++) {
-                devices[i] = currentProcess->devices[i];
-                if (devices[i] != nullptr)
-                    devices[i]->IncreamentRefCount();
+        for (uint64_t i = 0; i < currentProcess->devices.length(); i++) {
+            Device::Device* device = currentProcess->devices[i];
+            if (device != nullptr) {
+                devices.set(i, device);
+                device->IncreamentRefCount();
             }
         }
 
-        filesLength = currentProcess->filesLength;
-        if (filesLength > 0) {
-            files = new FileDescriptor*[filesLength];
-            for (uint64_t i = 0; i < filesLength; i++) {
-                files[i] = currentProcess->files[i];
-                if (files[i] != nullptr)
-                    files[i]->file->IncreamentRefCount();
+        for (uint64_t i = 0; i < currentProcess->files.length(); i++) {
+            // Each process frees its own descriptors, so they can't be shared
+            FileDescriptor* fileDescriptor = currentProcess->files[i];
+            if (fileDescriptor != nullptr) {
+                FileDescriptor* copy = new FileDescriptor(fileDescriptor->file, fileDescriptor->flags);
+                copy->offset = fileDescriptor->offset;
+                files.set(i, copy);
+                fileDescriptor->file->IncreamentRefCount();
             }
         }
 
@@ -78,12 +76,13 @@ Process::Process(const char* name) {
             currentDirectory = GetRootDirectory(0);
     } else {
         // Clear the hashmap
-        processHashMutex.Lock();
-        processHash[id % PROCESS_HASH_SIZE].push(this);
-        processHashMutex.Unlock();
+        processHashLock.Lock();
+        processHash.insert(id, this);
+        processHashLock.Unlock();
 
         // Set the current process to this
         currentProcess = this;
+        running = true;
 
         // Set the paging structure
         pagingStructure = Memory::Virtual::GetKernelPagingStructure();
@@ -95,8 +94,14 @@ Process::Process(const char* name) {
         // Set current directory to nullptr
         currentDirectory = nullptr;
     }
+
+    addressSpace = pagingStructure;
+    addressSpaceMutex = &pagingStructureMutex;
 }
 
+void* Process::operator new(size_t size) { return processCache.Allocate(size); }
+void Process::operator delete(void* ptr) { processCache.Free(ptr); }
+
 Process::~Process() {
     // Free the stack
     Memory::Heap::Free((void*)((uint64_t)stack - KERNEL_STACK_SIZE));
@@ -107,131 +112,46 @@ Process::~Process() {
     // Free the floating point storage
     Memory::Heap::Free(floatingPoint);
 
-    // Remove from hashmap
-    uint64_t idx = id % PROCESS_HASH_SIZE;
-    processHashMutex.Lock();
-    Queue<Process>::Iterator iter(&processHash[idx]);
-    do {
-        if (iter.value->id == id) {
-            iter.Remove();
-            break;
-        }
-    } while (iter.Next());
-
+    // Exit has already removed it from the hashmap
     // Close all descriptors
-    for (uint64_t i = 0; i < devicesLength; i++)
+    for (uint64_t i = 0; i < devices.length(); i++)
         if (devices[i] != nullptr)
             devices[i]->DecreamentRefCount();
 
-    for (uint64_t i = 0; i < filesLength; i++) {
+    for (uint64_t i = 0; i < files.length(); i++) {
         if (files[i] != nullptr) {
             files[i]->file->DecreamentRefCount();
             delete files[i];
         }
     }
 
-    processHashMutex.Unlock();
-
-    delete devices;
-    delete files;
     delete name;
 }
 
-uint64_t Process::AddDevice(Device::Device* device) {
-    for (uint64_t i = 0; i < devicesLength; i++) {
-        if (devices[i] == nullptr) {
-            devices[i] = device;
-            return i;
-        }
-    }
-
-    uint64_t newDeviceDescriptor = devicesLength;
-    devicesLength = devicesLength << 1;
-
-    if (devicesLength == 0)
-        devicesLength = 8;
-
-    Device::Device** newArray = new Device::Device*[devicesLength];
-
-    for (uint64_t i = 0; i < newDeviceDescriptor; i++)
-        newArray[i] = devices[i];
-
-    for (uint64_t i = newDeviceDescriptor; i < devicesLength; i++)
-        newArray[i] = nullptr;
-
-    newArray[newDeviceDescriptor] = device;
-
-    delete devices;
-    devices = newArray;
-
-    return newDeviceDescriptor;
-}
+uint64_t Process::AddDevice(Device::Device* device) { return devices.insert(device); }
 
 void Process::RemoveDevice(Device::Device* device) {
-    for (uint64_t i = 0; i < devicesLength; i++) {
+    for (uint64_t i = 0; i < devices.length(); i++) {
         if (devices[i] == device) {
-            devices[i] = nullptr;
+            devices.remove(i);
             return;
         }
     }
 }
 
-void Process::RemoveDevice(uint64_t deviceDescriptor) {
-    if (deviceDescriptor < devicesLength)
-        devices[deviceDescriptor] = nullptr;
-}
-
-Device::Device* Process::GetDevice(int deviceDescriptor) {
-    if ((uint64_t)deviceDescriptor >= devicesLength)
-        return nullptr;
-
-    return devices[deviceDescriptor];
-}
-
-uint64_t Process::AddFile(File* file, int flags) {
-    for (uint64_t i = 0; i < filesLength; i++) {
-        if (files[i] == nullptr) {
-            files[i] = new FileDescriptor(file, flags);
-            return i;
-        }
-    }
-
-    uint64_t newFileDescriptor = filesLength;
-    filesLength = filesLength << 1;
-
-    if (filesLength == 0)
-        filesLength = 8;
-
-    FileDescriptor** newArray = new FileDescriptor*[filesLength];
-
-    for (uint64_t i = 0; i < newFileDescriptor; i++)
-        newArray[i] = files[i];
-
-    for (uint64_t i = newFileDescriptor; i < filesLength; i++)
-        newArray[i] = nullptr;
+void Process::RemoveDevice(uint64_t deviceDescriptor) { devices.remove(deviceDescriptor); }
 
-    newArray[newFileDescriptor] = new FileDescriptor(file, flags);
+Device::Device* Process::GetDevice(int deviceDescriptor) { return devices[(uint64_t)deviceDescriptor]; }
 
-    delete files;
-    files = newArray;
-
-    return newFileDescriptor;
-}
+uint64_t Process::AddFile(File* file, int flags) { return files.insert(new FileDescriptor(file, flags)); }
 
 void Process::RemoveFile(File* file) {
-    for (uint64_t i = 0; i < filesLength; i++) {
-        if (files[i]->file == file) {
-            delete files[i];
-            files[i] = nullptr;
+    for (uint64_t i = 0; i < files.length(); i++) {
+        if (files[i] != nullptr && files[i]->file == file) {
+            delete files.remove(i);
             return;
         }
     }
 }
 
-void Process::RemoveFile(uint64_t fileDescriptor) {
-    if (fileDescriptor < filesLength) {
-        if (files[fileDescriptor] != nullptr)
-            delete files[fileDescriptor];
-        files[fileDescriptor] = nullptr;
-    }
-}
\ No newline at end of file
+void Process::RemoveFile(uint64_t fileDescriptor) { delete files.remove(fileDescriptor); }
\ No newline at end of file
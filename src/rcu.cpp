@@ -0,0 +1,99 @@
+#include <rcu.h>
+
+#include <panic.h>
+#include <process/control.h>
+#include <process/process.h>
+#include <spinlock.h>
+#include <waitqueue.h>
+
+namespace RCU {
+    struct SynchronizeWaiter {
+        RCUHead head;
+        WaitQueue queue;
+        bool done;
+    };
+
+    // Only guards the callback list, readers never touch it
+    Spinlock rcuLock("rcu");
+
+    // Callbacks queued since the last quiescent state, newest first
+    RCUHead* callbacks = nullptr;
+
+    // A read section holds preemption off, so with one processor no other process can be inside one
+    void ReadLock() {
+        PreemptDisable();
+        if (currentProcess != nullptr)
+            currentProcess->rcuNesting++;
+    }
+
+    void ReadUnlock() {
+        // Sections entered before the first process ran were never counted
+        if (currentProcess != nullptr && currentProcess->rcuNesting != 0)
+            currentProcess->rcuNesting--;
+        PreemptEnable();
+    }
+
+    void Call(RCUHead* head, void (*function)(RCUHead* head)) {
+        head->function = function;
+
+        uint64_t flags = rcuLock.AcquireIRQ();
+        head->next = callbacks;
+        callbacks = head;
+        rcuLock.ReleaseIRQ(flags);
+    }
+
+    static void WakeSynchronize(RCUHead* head) {
+        SynchronizeWaiter* waiter = (SynchronizeWaiter*)head;
+
+        rcuLock.Acquire();
+        waiter->done = true;
+        waiter->queue.WakeAll();
+        rcuLock.Release();
+    }
+
+    void Synchronize() {
+        // Nothing else has run yet, so there can't be any readers
+        if (currentProcess == nullptr)
+            return;
+
+        if (currentProcess->rcuNesting != 0)
+            panic("Attempting to synchronize RCU inside a read section!");
+
+        SynchronizeWaiter waiter;
+        waiter.done = false;
+        Call(&waiter.head, WakeSynchronize);
+
+        uint64_t flags = rcuLock.AcquireIRQ();
+        while (!waiter.done) {
+            waiter.queue.Sleep(rcuLock, flags);
+            flags = rcuLock.AcquireIRQ();
+        }
+        rcuLock.ReleaseIRQ(flags);
+    }
+
+    void QuiescentState() {
+        // Only reached with preemption enabled and interrupts disabled, so no read section is open anywhere
+        if (preemptCount != 0)
+            panic("RCU quiescent state with preemption disabled!");
+
+        rcuLock.Acquire();
+        RCUHead* queued = callbacks;
+        callbacks = nullptr;
+        rcuLock.Release();
+
+        // Run them in the order they were queued
+        RCUHead* ready = nullptr;
+        while (queued != nullptr) {
+            RCUHead* head = queued;
+            queued = head->next;
+            head->next = ready;
+            ready = head;
+        }
+
+        while (ready != nullptr) {
+            RCUHead* head = ready;
+            ready = head->next;
+            head->function(head);
+        }
+    }
+} // namespace RCU
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include <rwlock.h>
+
+#include <panic.h>
+#include <process/control.h>
+#include <process/process.h>
+
+#ifdef LOCK_STATS
+RWLock::RWLock(const char* name) : readers(0), waitingWriters(0), writer(false), lockStats(name) {}
+#else
+RWLock::RWLock(const char* name) : readers(0), waitingWriters(0), writer(false) {}
+#endif
+
+// Readers hold the lock together, so only writers are recorded in the lock stats
+void RWLock::LockShared() {
+    if (currentProcess == nullptr)
+        return;
+
+    uint64_t flags = lock.AcquireIRQ();
+    if (!writer && waitingWriters == 0) {
+        readers++;
+        lock.ReleaseIRQ(flags);
+        return;
+    }
+
+    // The writer that unlocks counts this reader in before waking it
+    readerQueue.Sleep(lock, flags);
+}
+
+void RWLock::UnlockShared() {
+    if (currentProcess == nullptr)
+        return;
+
+    uint64_t flags = lock.AcquireIRQ();
+    if (readers == 0)
+        panic("Attempting to unlock a reader-writer lock with no readers!");
+
+    readers--;
+    if (readers == 0 && writerQueue.HasWaiters()) {
+        writer = true;
+        waitingWriters--;
+        writerQueue.WakeOne();
+    }
+    lock.ReleaseIRQ(flags);
+}
+
+void RWLock::Lock() {
+    if (currentProcess == nullptr)
+        return;
+
+#ifdef LOCK_STATS
+    uint64_t start = ReadTSC();
+#endif
+
+    uint64_t flags = lock.AcquireIRQ();
+    if (!writer && readers == 0) {
+        writer = true;
+#ifdef LOCK_STATS
+        lockStats.Acquired(start, false);
+#endif
+        lock.ReleaseIRQ(flags);
+        return;
+    }
+
+    // Ownership is handed over before this writer is woken
+    waitingWriters++;
+    writerQueue.Sleep(lock, flags);
+
+#ifdef LOCK_STATS
+    lockStats.Acquired(start, true);
+#endif
+}
+
+void RWLock::Unlock() {
+    if (currentProcess == nullptr)
+        return;
+
+    uint64_t flags = lock.AcquireIRQ();
+    if (!writer)
+        panic("Attempting to unlock a reader-writer lock with no writer!");
+
+#ifdef LOCK_STATS
+    lockStats.Released();
+#endif
+
+    if (writerQueue.HasWaiters()) {
+        waitingWriters--;
+        writerQueue.WakeOne();
+    } else {
+        writer = false;
+        for (Process* reader = readerQueue.Dequeue(); reader != nullptr; reader = readerQueue.Dequeue()) {
+            readers++;
+            QueueExecution(reader);
+        }
+    }
+    lock.ReleaseIRQ(flags);
+}
\ No newline at end of file
@@ -1,16 +1,83 @@
 #include <semaphore.h>
 
+#include <asm.h>
+#include <process/control.h>
+#include <process/process.h>
+
 Semaphore::Semaphore(uint64_t initialValue, uint64_t maxValue) : value(initialValue), maxValue(maxValue) {}
 
 void Semaphore::Signal() {
-    value++;
-    if (value > maxValue)
-        value = maxValue;
+    uint64_t flags = lock.AcquireIRQ();
+
+    // Hand the unit straight to a waiter, so it can't be taken before the waiter runs
+    Process* waiter = waiters.Dequeue();
+    if (waiter != nullptr)
+        QueueExecution(waiter);
+    else {
+        uint64_t currentValue = value;
+        while (currentValue < maxValue && !CompareExchange(&value, currentValue, currentValue + 1))
+            currentValue = value;
+    }
+
+    lock.ReleaseIRQ(flags);
+}
+
+bool Semaphore::TryWait() {
+    uint64_t currentValue = value;
+    while (currentValue != 0) {
+        if (CompareExchange(&value, currentValue, currentValue - 1))
+            return true;
+
+        currentValue = value;
+    }
+
+    return false;
 }
 
 void Semaphore::Wait() {
-    while (value == 0)
-        asm volatile("pause");
+    if (TryWait())
+        return;
+
+    // Nothing can sleep before the first process exists
+    if (currentProcess == nullptr) {
+        while (!TryWait())
+            asm volatile("pause" : : : "memory");
+        return;
+    }
+
+    // Signal only raises the value under the lock, so checking again under it can't miss one
+    uint64_t flags = lock.AcquireIRQ();
+    if (TryWait()) {
+        lock.ReleaseIRQ(flags);
+        return;
+    }
+
+    waiters.Sleep(lock, flags);
+}
+
+bool Semaphore::Wait(time_t timeout) {
+    if (TryWait())
+        return true;
+
+    if (timeout == 0)
+        return false;
+
+    if (currentProcess == nullptr) {
+        time_t end = GetCurrentTime() + timeout;
+        while (!TryWait()) {
+            if (GetCurrentTime() >= end)
+                return false;
+
+            asm volatile("pause" : : : "memory");
+        }
+        return true;
+    }
+
+    uint64_t flags = lock.AcquireIRQ();
+    if (TryWait()) {
+        lock.ReleaseIRQ(flags);
+        return true;
+    }
 
-    value--;
+    return waiters.Sleep(lock, flags, timeout);
 }
\ No newline at end of file
@@ -1,10 +1,5 @@
-GLOBAL _ZN8SpinlockC1Ev
-_ZN8SpinlockC1Ev:
-    mov QWORD [rdi], 0
-    ret
-
-GLOBAL _ZN8Spinlock7AcquireEv
-_ZN8Spinlock7AcquireEv:
+GLOBAL AcquireSpinlock
+AcquireSpinlock:
     lock bts QWORD [rdi], 0        ;Attempt to acquire the lock (in case lock is uncontended)
     jc .spin_with_pause
     ret
@@ -13,9 +8,78 @@ _ZN8Spinlock7AcquireEv:
     pause                    ; Tell CPU we're spinning
     test QWORD [rdi], 1      ; Is the lock free?
     jnz .spin_with_pause     ; no, wait
-    jmp _ZN8Spinlock7AcquireEv          ; retry
+    jmp AcquireSpinlock          ; retry
+
+GLOBAL TryAcquireSpinlock
+TryAcquireSpinlock:
+    xor rax, rax
+    lock bts QWORD [rdi], 0        ; CF <-- previous lock bit
+    setnc al
+    ret
  
-GLOBAL _ZN8Spinlock7ReleaseEv
-_ZN8Spinlock7ReleaseEv:
+GLOBAL ReleaseSpinlock
+ReleaseSpinlock:
     mov QWORD [rdi],0
+    ret
+
+GLOBAL AcquireTicketLock
+AcquireTicketLock:
+    mov rax, 1
+    lock xadd QWORD [rdi], rax     ; Take the next ticket
+
+.wait_for_turn:
+    cmp QWORD [rdi + 8], rax       ; Is our ticket being served?
+    je .acquired
+    pause
+    jmp .wait_for_turn
+
+.acquired:
+    ret
+
+GLOBAL ReleaseTicketLock
+ReleaseTicketLock:
+    inc QWORD [rdi + 8]            ; Only the holder writes this, so it needs no lock prefix
+    ret
+
+GLOBAL AcquireMCSLock
+AcquireMCSLock:
+    mov QWORD [rsi], 0             ; node->next = nullptr
+    mov QWORD [rsi + 8], 1         ; node->locked = 1
+
+    mov rax, rsi
+    xchg [rdi], rax                ; Append to the queue, rax <-- previous tail
+    test rax, rax
+    jz .acquired
+
+    mov [rax], rsi                 ; previous->next = node
+
+.spin_with_pause:
+    pause                          ; Each waiter spins on its own node
+    cmp QWORD [rsi + 8], 0
+    jne .spin_with_pause
+
+.acquired:
+    ret
+
+GLOBAL ReleaseMCSLock
+ReleaseMCSLock:
+    mov rdx, [rsi]                 ; rdx <-- node->next
+    test rdx, rdx
+    jnz .handoff
+
+    mov rax, rsi
+    xor rcx, rcx
+    lock cmpxchg [rdi], rcx        ; No successor, clear the tail if it is still us
+    je .released
+
+.wait_for_successor:
+    pause                          ; A successor swapped the tail but hasn't linked itself yet
+    mov rdx, [rsi]
+    test rdx, rdx
+    jz .wait_for_successor
+
+.handoff:
+    mov QWORD [rdx + 8], 0         ; successor->locked = 0
+
+.released:
     ret
\ No newline at end of file
@@ -1,11 +1,20 @@
+#include <arena.h>
 #include <console.h>
 #include <device/manager.h>
+#include <errno.h>
 #include <fs.h>
+#include <lockstat.h>
+#include <memory/heap.h>
+#include <memory/physical.h>
+#include <process/futex.h>
 #include <process/control.h>
 #include <string.h>
 #include <time.h>
 
-extern "C" uint64_t SystemCall(uint64_t num, uint64_t arg1, uint64_t arg2, uint64_t arg3, uint64_t arg4) {
+// The whole buffer must lie below the kernel, checked without overflowing
+static inline bool IsUserBuffer(uint64_t address, uint64_t size) { return address < KERNEL_VMA && size <= KERNEL_VMA - address; }
+
+static uint64_t DispatchSystemCall(uint64_t num, uint64_t arg1, uint64_t arg2, uint64_t arg3, uint64_t arg4) {
     switch (num) {
     case 0:
         Exit(arg1);
@@ -28,6 +37,8 @@ extern "C" uint64_t SystemCall(uint64_t num, uint64_t arg1, uint64_t arg2, uint6
         if (arg1 >= KERNEL_VMA || arg2 >= KERNEL_VMA || arg3 >= KERNEL_VMA)
             return 0;
 
+        ArenaScope scope(&currentProcess->arena);
+
         // Copy args into kernel space
         int argc = 0;
         const char** argvUser = (const char**)arg2;
@@ -39,10 +50,10 @@ extern "C" uint64_t SystemCall(uint64_t num, uint64_t arg1, uint64_t arg2, uint6
                 return 0;
         }
 
-        char** argvKernel = new char*[argc + 1];
+        char** argvKernel = scope.Allocate<char*>(argc + 1);
         int i;
         for (i = 0; i < argc; i++) {
-            char* arg = new char[strlen(argvUser[i]) + 1];
+            char* arg = scope.Allocate<char>(strlen(argvUser[i]) + 1);
             strcpy(arg, argvUser[i]);
             argvKernel[i] = arg;
         }
@@ -59,22 +70,15 @@ extern "C" uint64_t SystemCall(uint64_t num, uint64_t arg1, uint64_t arg2, uint6
                 return 0;
         }
 
-        char** envpKernel = new char*[envc + 1];
+        char** envpKernel = scope.Allocate<char*>(envc + 1);
         for (i = 0; i < envc; i++) {
-            char* envVar = new char[strlen(envpUser[i]) + 1];
+            char* envVar = scope.Allocate<char>(strlen(envpUser[i]) + 1);
             strcpy(envVar, envpUser[i]);
             envpKernel[i] = envVar;
         }
         envpKernel[i] = nullptr;
 
-        uint64_t ret = Execute((const char*)arg1, (const char**)argvKernel, (const char**)envpKernel);
-        for (i = 0; i < argc; i++)
-            delete argvKernel[i];
-        for (i = 0; i < envc; i++)
-            delete envpKernel[i];
-        delete argvKernel;
-        delete envpKernel;
-        return ret;
+        return Execute((const char*)arg1, (const char**)argvKernel, (const char**)envpKernel);
     }
 
     case 4:
@@ -109,7 +113,7 @@ extern "C" uint64_t SystemCall(uint64_t num, uint64_t arg1, uint64_t arg2, uint6
         return Write(arg1, (void*)arg2, arg3);
 
     case 12:
-        if (arg1 >= KERNEL_VMA)
+        if (!IsUserBuffer(arg1, arg2))
             break;
 
         return GetCurrentWorkingDirectory((void*)arg1, arg2);
@@ -135,9 +139,50 @@ extern "C" uint64_t SystemCall(uint64_t num, uint64_t arg1, uint64_t arg2, uint6
     case 17:
         return Truncate(arg1, arg2);
 
+    case 18:
+        return Memory::Heap::PrintProfile(arg1, arg2);
+
+    case 19:
+        if (!IsUserBuffer(arg1, arg2))
+            break;
+
+        return Console::ReadLog((void*)arg1, arg2);
+
+    case 20:
+        return FutexWait((uint32_t*)arg1, arg2, arg3);
+
+    case 21:
+        return FutexWake((uint32_t*)arg1, arg2);
+
+    case 22:
+        return PrintLockStats(arg1);
+
+    case 23:
+        // The scheduler always runs the highest priority, so a raised user process could starve everything else
+        if (arg1 > PROCESS_DEFAULT_PRIORITY)
+            return ERROR_OUT_OF_RANGE;
+
+        Mutex::SetPriority(currentProcess, arg1);
+        return SUCCESS;
+
+    case 24: {
+        uint64_t assembled = Memory::Physical::Compact(arg1);
+        if (assembled != ~(uint64_t)0)
+            Memory::Physical::PrintCompactionStats();
+        return assembled;
+    }
+
     default:
         Console::Println("Unhandled system call (%#llx)", num);
     }
 
     return ~0;
+}
+
+// No kernel locks are held on the way back to user mode, so exited processes are freed there
+// The scheduler can't free them itself, it runs with interrupts disabled and freeing may sleep
+extern "C" uint64_t SystemCall(uint64_t num, uint64_t arg1, uint64_t arg2, uint64_t arg3, uint64_t arg4) {
+    uint64_t ret = DispatchSystemCall(num, arg1, arg2, arg3, arg4);
+    ReapProcesses();
+    return ret;
 }
\ No newline at end of file
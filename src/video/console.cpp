@@ -2,7 +2,10 @@
 
 #include <bootloader.h>
 #include <errno.h>
+#include <interrupt/irq.h>
+#include <mutex.h>
 #include <panic.h>
+#include <ringbuffer.h>
 #include <stdarg.h>
 #include <string.h>
 
@@ -13,7 +16,44 @@ namespace Console {
     void SetStdOutput(Device::Device* device) { stdOutput = device; }
     void SetStdInput(Device::Device* device) { stdInput = device; }
 
+    // Anything can print, so the ring has many producers and several readers
+    // Producers are serialized by disabling interrupts on this single processor, readers by the mutex
+    RingBuffer<char, CONSOLE_LOG_SIZE> kernelLog;
+    Mutex kernelLogMutex("kernel log");
+
+    // Producers can run in interrupt handlers and can't take the mutex to discard old output
+    // So a full log keeps what it has, and the bytes lost are counted and reported to the next reader
+    uint64_t droppedLogBytes;
+
+    void Log(const char* str, uint64_t length) {
+        uint64_t flags = Interrupt::Disable();
+        droppedLogBytes += length - kernelLog.push(str, length);
+        Interrupt::Restore(flags);
+    }
+
+    int64_t ReadLog(void* buffer, int64_t count) {
+        if (count <= 0)
+            return 0;
+
+        kernelLogMutex.Lock();
+        int64_t ret = kernelLog.pop((char*)buffer, count);
+        kernelLogMutex.Unlock();
+
+        uint64_t flags = Interrupt::Disable();
+        uint64_t dropped = droppedLogBytes;
+        droppedLogBytes = 0;
+        Interrupt::Restore(flags);
+
+        // The notice is queued behind whatever is still unread, and is counted again if it doesn't fit
+        if (dropped > 0)
+            Println("[ Log ] %lli bytes dropped while the log was full", dropped);
+
+        return ret;
+    }
+
     void DisplayCharacter(char character) {
+        Log(&character, 1);
+
         if (stdOutput == nullptr)
             return;
 
@@ -21,6 +61,8 @@ namespace Console {
     }
 
     int DisplayString(const char* str) {
+        Log(str, strlen(str));
+
         if (stdOutput == nullptr)
             return 0;
 
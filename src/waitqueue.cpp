@@ -0,0 +1,121 @@
+#include <waitqueue.h>
+
+#include <interrupt/irq.h>
+#include <process/control.h>
+#include <process/process.h>
+
+static bool WakesBefore(Process* a, Process* b) { return a->wait.wakeTime < b->wait.wakeTime; }
+
+// Sleepers with a timeout, ordered by wake time
+RBTree<Process, WakesBefore> timers;
+Spinlock timersLock("wait queue timers");
+
+static void CancelTimer(Process* process) {
+    uint64_t flags = timersLock.AcquireIRQ();
+    if (process->wait.timerQueued) {
+        timers.remove(&process->wait.timerNode);
+        process->wait.timerQueued = false;
+    }
+    timersLock.ReleaseIRQ(flags);
+}
+
+void WaitQueue::Sleep(Spinlock& lock, uint64_t flags) {
+    currentProcess->wait.queue = this;
+    currentProcess->wait.lock = &lock;
+    waiters.push(currentProcess, &currentProcess->queueNode);
+
+    // Interrupts stay disabled until the switch, so a wakeup can't requeue this process while it still runs here
+    lock.Release();
+    Yield();
+    Interrupt::Restore(flags);
+}
+
+bool WaitQueue::Sleep(Spinlock& lock, uint64_t flags, time_t timeout) {
+    currentProcess->wait.timedOut = false;
+    currentProcess->wait.wakeTime = GetCurrentTime() + timeout;
+
+    uint64_t timersFlags = timersLock.AcquireIRQ();
+    timers.insert(&currentProcess->wait.timerNode, currentProcess);
+    currentProcess->wait.timerQueued = true;
+    timersLock.ReleaseIRQ(timersFlags);
+
+    Sleep(lock, flags);
+    return !currentProcess->wait.timedOut;
+}
+
+bool WaitQueue::Block(Spinlock& lock, uint64_t flags, time_t deadline) {
+    time_t now = GetCurrentTime();
+    if (deadline != 0 && now >= deadline) {
+        lock.ReleaseIRQ(flags);
+        return false;
+    }
+
+    // Nothing can be scheduled before the first process, so poll instead
+    if (currentProcess == nullptr) {
+        lock.ReleaseIRQ(flags);
+        asm volatile("pause");
+        return true;
+    }
+
+    if (deadline == 0)
+        Sleep(lock, flags);
+    else
+        Sleep(lock, flags, deadline - now);
+
+    return true;
+}
+
+Process* WaitQueue::Dequeue() {
+    Process* process = waiters.front();
+    if (process == nullptr)
+        return nullptr;
+
+    waiters.pop();
+    Detach(process);
+    return process;
+}
+
+void WaitQueue::Detach(Process* process) {
+    process->wait.queue = nullptr;
+    CancelTimer(process);
+}
+
+void WaitQueue::WakeOne() {
+    Process* process = Dequeue();
+    if (process != nullptr)
+        QueueExecution(process);
+}
+
+void WaitQueue::WakeAll() {
+    for (Process* process = Dequeue(); process != nullptr; process = Dequeue())
+        QueueExecution(process);
+}
+
+void WaitQueue::ExpireTimers(time_t now) {
+    while (true) {
+        // Dequeue takes the timer lock inside the queue's lock, so it has to be released before taking the queue's
+        timersLock.Acquire();
+        RBNode<Process>* node = timers.front();
+        if (node == nullptr || node->value->wait.wakeTime > now) {
+            timersLock.Release();
+            return;
+        }
+
+        Process* process = node->value;
+        timers.remove(node);
+        process->wait.timerQueued = false;
+        timersLock.Release();
+
+        // A waker that dequeued it first has already queued it for execution
+        Spinlock* lock = process->wait.lock;
+        lock->Acquire();
+        WaitQueue* queue = process->wait.queue;
+        if (queue != nullptr) {
+            queue->waiters.remove(&process->queueNode);
+            process->wait.queue = nullptr;
+            process->wait.timedOut = true;
+            QueueExecution(process);
+        }
+        lock->Release();
+    }
+}
\ No newline at end of file